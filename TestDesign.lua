@@ -7,6 +7,14 @@ return {
 	},
 	
 	defines = "", -- Additional defines prepended to the C++ code
+
+	functions = { -- C++ functions registered with SQLite by registerFunctions(), usable in scripts and predicates
+		-- <SQL name> = <C++ function>, e.g. normalize = "normalizeName"
+	},
+
+	aggregates = { -- C++ aggregates registered with SQLite by registerFunctions()
+		-- <SQL name> = <C++ class with step(<args>) and finish()>, e.g. product = "Product"
+	},
 	tables = { -- The actual table definitions
 		table = { 
 			field1 = "string", -- <fieldname> = <fieldtype>
@@ -15,7 +23,24 @@ return {
 		},
 		table2 = {
 			reference = "table", -- Fieldtype can be other structure in the database
-			field = "int"
+			field = "int",
+			data = "blob" -- Binary data, read and written with incremental I/O on SQLite
 		}
+	},
+
+	indexes = { -- Additional indexes, fields referencing other tables are indexed automatically
+		table = {
+			-- { <fields>, unique = <bool>, where = <SQLite partial index condition> }
+			-- MariaDB has no partial indexes, it indexes all rows and drops unique from partial indexes.
+			{ "field1", "field2" },
+			{ "field3", where = "`field3` <> ''" }
+		},
+		table2 = {
+			{ "data" }
+		}
+	},
+
+	searchable = { -- Tables with a full text index used by search<T>
+		table = { "field1", "field2" } -- <table> = { <fields> } or true for all string fields
 	}
 }
@@ -0,0 +1,365 @@
+#ifndef LUASQLGEN_CSVLOADER_H
+#define LUASQLGEN_CSVLOADER_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <deque>
+#include <charconv>
+#include <chrono>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <exception>
+#include <stdexcept>
+#include <cstring>
+#include <cstddef>
+#include <cerrno>
+
+#ifdef WIN32
+#include <fstream>
+#include <sstream>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace luasqlgen
+{
+
+// Read-only memory mapping of a whole file.
+class MappedFile
+{
+	const char* m_data = nullptr;
+	size_t m_size = 0;
+
+#ifdef WIN32
+	std::string m_buffer;
+#endif
+
+public:
+	MappedFile(const std::string& path)
+	{
+#ifdef WIN32
+		std::ifstream in(path, std::ios::binary);
+		if(!in)
+			throw std::runtime_error("Could not open file: " + path);
+
+		std::stringstream buf;
+		buf << in.rdbuf();
+		m_buffer = buf.str();
+		m_data = m_buffer.data();
+		m_size = m_buffer.size();
+#else
+		int fd = open(path.c_str(), O_RDONLY);
+		if(fd < 0)
+			throw std::runtime_error("Could not open file: " + path + ": " + strerror(errno));
+
+		struct stat info;
+		if(fstat(fd, &info) != 0)
+		{
+			::close(fd);
+			throw std::runtime_error("Could not stat file: " + path + ": " + strerror(errno));
+		}
+
+		m_size = info.st_size;
+		if(m_size > 0)
+		{
+			void* data = mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+			if(data == MAP_FAILED)
+			{
+				::close(fd);
+				throw std::runtime_error("Could not map file: " + path + ": " + strerror(errno));
+			}
+
+			madvise(data, m_size, MADV_SEQUENTIAL);
+			m_data = static_cast<const char*>(data);
+		}
+
+		::close(fd);
+#endif
+	}
+
+	~MappedFile()
+	{
+#ifndef WIN32
+		if(m_data)
+			munmap(const_cast<char*>(m_data), m_size);
+#endif
+	}
+
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	std::string_view data() const { return std::string_view(m_data, m_size); }
+};
+
+/**
+ * Splits CSV (RFC 4180) or TSV data into records.
+ *
+ * Fields point directly into the input. Only quoted fields containing escaped quotes ("")
+ * are copied into scratch storage, which stays valid until the next call to next().
+ */
+class CSVReader
+{
+	std::string_view m_data;
+	size_t m_pos = 0;
+	char m_delimiter;
+	std::deque<std::string> m_scratch;
+
+	bool isFieldEnd(char c) const { return c == m_delimiter || c == '\n' || c == '\r'; }
+
+	std::string_view readQuoted()
+	{
+		const size_t start = ++m_pos;
+		size_t chunk = start;
+		std::string* unescaped = nullptr;
+
+		while(m_pos < m_data.size())
+		{
+			if(m_data[m_pos] != '"')
+			{
+				m_pos++;
+				continue;
+			}
+
+			if(m_pos + 1 < m_data.size() && m_data[m_pos + 1] == '"')
+			{
+				if(!unescaped)
+				{
+					m_scratch.emplace_back();
+					unescaped = &m_scratch.back();
+				}
+
+				// Copy everything up to and including the first quote, skip the second one
+				unescaped->append(m_data.data() + chunk, m_pos + 1 - chunk);
+				m_pos += 2;
+				chunk = m_pos;
+				continue;
+			}
+
+			std::string_view field;
+			if(unescaped)
+			{
+				unescaped->append(m_data.data() + chunk, m_pos - chunk);
+				field = *unescaped;
+			}
+			else
+			{
+				field = m_data.substr(start, m_pos - start);
+			}
+
+			// Skip the closing quote and anything following it up to the next field
+			m_pos++;
+			while(m_pos < m_data.size() && !isFieldEnd(m_data[m_pos]))
+				m_pos++;
+
+			return field;
+		}
+
+		throw std::runtime_error("Unterminated quoted field in CSV data");
+	}
+
+public:
+	CSVReader(std::string_view data, char delimiter = ','):
+		m_data(data), m_delimiter(delimiter) {}
+
+	// Reads the next record, returns false at the end of the data. Empty lines are skipped.
+	bool next(std::vector<std::string_view>& fields)
+	{
+		fields.clear();
+		m_scratch.clear();
+
+		while(m_pos < m_data.size() && (m_data[m_pos] == '\n' || m_data[m_pos] == '\r'))
+			m_pos++;
+
+		if(m_pos >= m_data.size())
+			return false;
+
+		while(true)
+		{
+			if(m_pos < m_data.size() && m_data[m_pos] == '"')
+			{
+				fields.push_back(readQuoted());
+			}
+			else
+			{
+				const size_t start = m_pos;
+				while(m_pos < m_data.size() && !isFieldEnd(m_data[m_pos]))
+					m_pos++;
+
+				fields.push_back(m_data.substr(start, m_pos - start));
+			}
+
+			if(m_pos >= m_data.size())
+				return true;
+
+			const char c = m_data[m_pos++];
+			if(c == m_delimiter)
+				continue;
+
+			if(c == '\r' && m_pos < m_data.size() && m_data[m_pos] == '\n')
+				m_pos++;
+
+			return true;
+		}
+	}
+};
+
+// Converts a CSV field into a struct member. Empty fields keep the default value.
+template<typename T>
+void parseField(std::string_view in, T& out)
+{
+	if(in.empty())
+		return;
+
+	const char* end = in.data() + in.size();
+	auto result = std::from_chars(in.data(), end, out);
+	if(result.ec != std::errc() || result.ptr != end)
+		throw std::runtime_error("Could not convert CSV field: " + std::string(in));
+}
+
+inline void parseField(std::string_view in, std::string& out)
+{
+	out.assign(in);
+}
+
+// Blobs are hex encoded, as written by TableExporter
+inline void parseField(std::string_view in, std::vector<std::byte>& out)
+{
+	if(!hexToBlob(in, out))
+		throw std::runtime_error("Could not convert CSV field: " + std::string(in));
+}
+
+inline void parseField(std::string_view in, bool& out)
+{
+	if(in.empty())
+		return;
+
+	if(in == "1" || in == "true" || in == "TRUE")
+		out = true;
+	else if(in == "0" || in == "false" || in == "FALSE")
+		out = false;
+	else
+		throw std::runtime_error("Could not convert CSV field: " + std::string(in));
+}
+
+struct LoadStats
+{
+	size_t rows = 0;
+	double seconds = 0.0;
+
+	double rowsPerSecond() const { return seconds > 0.0 ? rows / seconds : 0.0; }
+};
+
+/**
+ * Parses all remaining records of the reader on a separate thread and hands batches
+ * of batchSize objects to the write function on the calling thread.
+ *
+ * parse(const std::vector<std::string_view>& fields, T& object) fills one object,
+ * write(std::vector<T>& batch) stores a batch. Errors on either side stop both stages
+ * and are rethrown on the calling thread.
+ */
+template<typename T, typename ParseFn, typename WriteFn>
+LoadStats loadParallel(CSVReader& reader, size_t batchSize, ParseFn parse, WriteFn write)
+{
+	// Limits the memory used by parsed but not yet written batches
+	const size_t maxQueued = 4;
+
+	const auto start = std::chrono::steady_clock::now();
+	std::mutex mutex;
+	std::condition_variable cv;
+	std::deque<std::vector<T>> queue;
+	std::exception_ptr parseError;
+	bool done = false;
+	bool cancelled = false;
+
+	std::thread parser([&]()
+	{
+		try
+		{
+			std::vector<std::string_view> fields;
+			std::vector<T> batch;
+			batch.reserve(batchSize);
+
+			while(reader.next(fields))
+			{
+				batch.emplace_back();
+				parse(fields, batch.back());
+
+				if(batch.size() == batchSize)
+				{
+					std::unique_lock<std::mutex> lock(mutex);
+					cv.wait(lock, [&]() { return queue.size() < maxQueued || cancelled; });
+					if(cancelled)
+						break;
+
+					queue.push_back(std::move(batch));
+					cv.notify_all();
+
+					batch = std::vector<T>();
+					batch.reserve(batchSize);
+				}
+			}
+
+			std::lock_guard<std::mutex> lock(mutex);
+			if(!batch.empty() && !cancelled)
+				queue.push_back(std::move(batch));
+		}
+		catch(...)
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			parseError = std::current_exception();
+		}
+
+		std::lock_guard<std::mutex> lock(mutex);
+		done = true;
+		cv.notify_all();
+	});
+
+	LoadStats stats;
+	try
+	{
+		while(true)
+		{
+			std::vector<T> batch;
+			{
+				std::unique_lock<std::mutex> lock(mutex);
+				cv.wait(lock, [&]() { return !queue.empty() || done; });
+				if(parseError || queue.empty())
+					break;
+
+				batch = std::move(queue.front());
+				queue.pop_front();
+				cv.notify_all();
+			}
+
+			write(batch);
+			stats.rows += batch.size();
+		}
+	}
+	catch(...)
+	{
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			cancelled = true;
+			cv.notify_all();
+		}
+
+		parser.join();
+		throw;
+	}
+
+	parser.join();
+	if(parseError)
+		std::rethrow_exception(parseError);
+
+	stats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	return stats;
+}
+
+}
+
+#endif
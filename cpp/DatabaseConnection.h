@@ -2,12 +2,21 @@
 #define LUASQLGEN_DATABASECONNECTION_H
 
 #include <string>
+#include <string_view>
 #include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <limits>
+#include <type_traits>
 #include <unordered_map>
 #include <memory>
 #include <sstream>
 #include <iomanip>
 #include <fstream>
+#include <stdexcept>
+#include <algorithm>
+#include <charconv>
+#include <cstdio>
 
 namespace luasqlgen
 {
@@ -22,11 +31,183 @@ enum DBTYPE
 typedef std::unordered_map<std::string, std::string> ResultLine;
 typedef std::vector<ResultLine> DatabaseResult;
 
+// Value of blob fields
+typedef std::vector<std::byte> Blob;
+
+enum ARG_TYPE
+{
+	ARG_TEXT = 0,
+	ARG_BLOB,
+	ARG_INTEGER,
+	ARG_UNSIGNED, // Integers above INT64_MAX, stored in integer as bit pattern
+	ARG_REAL
+};
+
+// Formats a floating point number with as many digits as it takes to read back the same value,
+// std::to_string always rounds to six decimals.
+template<typename T>
+inline std::string realToString(T value)
+{
+	char buffer[32];
+#ifdef __cpp_lib_to_chars
+	const auto end = std::to_chars(buffer, buffer + sizeof(buffer), value).ptr;
+	return std::string(buffer, end);
+#else
+	std::snprintf(buffer, sizeof(buffer), "%.*g", std::numeric_limits<T>::max_digits10, static_cast<double>(value));
+	return buffer;
+#endif
+}
+
+/**
+ * Statement argument which refers to the caller's memory instead of copying it.
+ * Text and blobs have to stay alive until the query returns, which is the case for
+ * temporaries created in the argument list of the call.
+ */
+struct ArgView
+{
+	ARG_TYPE type = ARG_TEXT;
+	std::string_view data;
+	int64_t integer = 0;
+	double real = 0.0;
+
+	ArgView(const std::string& value): data(value) {}
+	ArgView(std::string_view value): data(value) {}
+	ArgView(const char* value): data(value) {}
+	ArgView(const Blob& value): type(ARG_BLOB), data(reinterpret_cast<const char*>(value.data()), value.size()) {}
+
+	template<typename T, typename std::enable_if<std::is_integral<T>::value, int>::type = 0>
+	ArgView(T value): type(ARG_INTEGER), integer(static_cast<int64_t>(value))
+	{
+		if(std::is_unsigned<T>::value && static_cast<uint64_t>(value) > static_cast<uint64_t>(std::numeric_limits<int64_t>::max()))
+			type = ARG_UNSIGNED;
+	}
+
+	template<typename T, typename std::enable_if<std::is_floating_point<T>::value, int>::type = 0>
+	ArgView(T value): type(ARG_REAL), real(value) {}
+
+	static ArgView blob(const void* data, size_t size)
+	{
+		ArgView arg(std::string_view(static_cast<const char*>(data), size));
+		arg.type = ARG_BLOB;
+		return arg;
+	}
+
+	std::string toString() const
+	{
+		switch(type)
+		{
+			case ARG_INTEGER: return std::to_string(integer);
+			case ARG_UNSIGNED: return std::to_string(static_cast<uint64_t>(integer));
+			case ARG_REAL: return realToString(real);
+			default: return std::string(data);
+		}
+	}
+};
+
+typedef std::vector<ArgView> ArgViews;
+
+// Blob values are returned like text in DatabaseResult rows, byte by byte and including NULs.
+inline void toBlob(const std::string& in, Blob& out)
+{
+	const std::byte* data = reinterpret_cast<const std::byte*>(in.data());
+	out.assign(data, data + in.size());
+}
+
+inline std::string blobToString(const Blob& in)
+{
+	return std::string(reinterpret_cast<const char*>(in.data()), in.size());
+}
+
+// Lower case hex digits of all bytes, used where blobs have to be printed as text.
+inline std::string blobToHex(const Blob& in)
+{
+	static const char digits[] = "0123456789abcdef";
+	std::string result;
+	result.reserve(in.size() * 2);
+	for(auto b : in)
+	{
+		result += digits[std::to_integer<unsigned int>(b) >> 4];
+		result += digits[std::to_integer<unsigned int>(b) & 0xf];
+	}
+	return result;
+}
+
+// Reverse of blobToHex, accepts upper and lower case digits. Returns false for anything else.
+inline bool hexToBlob(std::string_view in, Blob& out)
+{
+	auto digit = [](char c) -> int
+	{
+		if(c >= '0' && c <= '9') return c - '0';
+		if(c >= 'a' && c <= 'f') return c - 'a' + 10;
+		if(c >= 'A' && c <= 'F') return c - 'A' + 10;
+		return -1;
+	};
+
+	if(in.size() % 2)
+		return false;
+
+	out.resize(in.size() / 2);
+	for(size_t i = 0; i < out.size(); i++)
+	{
+		const int high = digit(in[2*i]), low = digit(in[2*i + 1]);
+		if(high < 0 || low < 0)
+			return false;
+		out[i] = static_cast<std::byte>(high << 4 | low);
+	}
+	return true;
+}
+
+// Thrown when a statement fails because of lock contention (SQLITE_BUSY, deadlocks, lock wait timeouts).
+// The transaction can be retried, see TransactionRetry.
+class BusyError : public std::runtime_error
+{
+public:
+	BusyError(const std::string& msg) : std::runtime_error(msg) {}
+};
+
+// Builds a comma separated list of count '?' placeholders, e.g. for "in (...)" lists.
+inline std::string makePlaceholders(size_t count)
+{
+	std::string result;
+	result.reserve(count * 2);
+	for(size_t i = 0; i < count; i++)
+		result += i ? ",?" : "?";
+	return result;
+}
+
+// Builds the values list of a multi-row insert, e.g. "(?,?),(?,?)" for 2 columns and 2 rows.
+inline std::string makeRowPlaceholders(size_t columns, size_t rows)
+{
+	const std::string row = "(" + makePlaceholders(columns) + ")";
+	std::string result;
+	result.reserve((row.size() + 1) * rows);
+	for(size_t i = 0; i < rows; i++)
+	{
+		if(i) result += ",";
+		result += row;
+	}
+	return result;
+}
+
+// Result column of a prepared statement
+struct ColumnInfo
+{
+	std::string name;
+	std::string declType; // Type as declared in the schema, empty if the backend does not report it
+};
+
 class DatabaseConnection;
 class PreparedStmt
 {
 	std::string m_sources;
-	
+
+protected:
+	// Captured once by the backends instead of being looked up for every row
+	std::vector<ColumnInfo> m_columns;
+
+	// For backends which prepare the source themselves instead of through build()
+	void setSource(const std::string& source) { m_sources = source; }
+
 public:
 	// Escapes JSON strings using STL only.
 	// FIXME Is this fast enough?
@@ -65,6 +246,9 @@ public:
 	virtual void query() = 0;
 	virtual void query(const std::vector<std::string>& args, DatabaseResult& result) = 0;
 
+	// Reads the first column of the first row only. Returns false if there is no row or the value is NULL.
+	virtual bool queryScalar(const std::vector<std::string>& args, std::string& value) = 0;
+
 	virtual void build() = 0;
 	void buildSource(const std::string& source)
 	{
@@ -73,10 +257,16 @@ public:
 	}
 	
 	std::string getSource() const { return m_sources; }
+
+	// Result columns, known after build(). MariaDB only reports them after the first execution.
+	const std::vector<ColumnInfo>& getColumns() const { return m_columns; }
+	size_t getColumnCount() const { return m_columns.size(); }
 };
 
 class DatabaseConnection
 {
+	friend class Transaction;
+	unsigned int m_transactionDepth = 0;
 
 public:
 	virtual ~DatabaseConnection() = default;
@@ -90,11 +280,72 @@ public:
 
 	virtual std::string queryJson(const std::string& query) = 0;
 	virtual std::string queryJson(const std::string& query, const std::vector<std::string>& args) = 0;
+	virtual bool queryScalar(const std::string& query, const std::vector<std::string>& args, std::string& value) = 0;
+
+	// Like query with arguments, but binds the arguments without copying them if the backend supports it.
+	virtual void queryRef(const std::string& query, const ArgViews& args, DatabaseResult& result)
+	{
+		std::vector<std::string> strings;
+		strings.reserve(args.size());
+		for(const auto& arg : args)
+			strings.push_back(arg.toString());
+
+		this->query(query, strings, result);
+	}
+
+	void queryRef(const std::string& query, const ArgViews& args)
+	{
+		DatabaseResult result;
+		queryRef(query, args, result);
+	}
 	
+	// Marks the statement of the next query call as one which runs for the lifetime of the connection,
+	// e.g. the fixed statements of generated code. Backends which support it prepare it accordingly.
+	virtual DatabaseConnection& persistent() { return *this; }
+
 	virtual std::shared_ptr<PreparedStmt> getStatement(const std::string& source) = 0;
 	virtual unsigned long long getLastInsertID() = 0;
 	virtual const char* getName() const = 0;
 	virtual DBTYPE getType() const = 0;
+
+	// Streams the blob column of one row to out in chunks of chunkSize bytes and returns the number of bytes written.
+	// Backends without incremental blob I/O read the chunks with substr(), so only one chunk is in memory at a time.
+	virtual size_t readBlob(const std::string& table, const std::string& column, unsigned long long id,
+				std::ostream& out, size_t chunkSize = 1 << 20)
+	{
+		const std::string source = "select substr(`" + column + "`, ?, ?) from `" + table + "` where id = ?;";
+		const std::string idArg = std::to_string(id);
+
+		size_t total = 0;
+		std::string chunk;
+		while(queryScalar(source, {std::to_string(total + 1), std::to_string(chunkSize), idArg}, chunk) && !chunk.empty())
+		{
+			out.write(chunk.data(), chunk.size());
+			total += chunk.size();
+			if(chunk.size() < chunkSize)
+				break;
+		}
+		return total;
+	}
+
+	// Replaces the blob column of one row with size bytes read from in, chunkSize bytes at a time.
+	// Backends without incremental blob I/O read the whole value into memory and write it with a
+	// single update, appending chunk by chunk would rewrite the value for every chunk.
+	virtual void writeBlob(const std::string& table, const std::string& column, unsigned long long id,
+				std::istream& in, size_t size, size_t chunkSize = 1 << 20)
+	{
+		std::vector<char> data(size);
+		if(size && !in.read(data.data(), size))
+			throw std::runtime_error("Could not read blob data for " + table + "." + column + "!");
+
+		queryRef("update `" + table + "` set `" + column + "` = ? where id = ?;", {ArgView::blob(data.data(), size), id});
+	}
+
+	// Number of parameters batched operations should bind to a single statement.
+	virtual size_t getBatchSize() const { return 100; }
+
+	// Number of currently open Transaction scopes on this connection.
+	unsigned int getTransactionDepth() const { return m_transactionDepth; }
 };
 
 }
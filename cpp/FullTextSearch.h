@@ -0,0 +1,41 @@
+#ifndef LUASQLGEN_FULLTEXTSEARCH_H
+#define LUASQLGEN_FULLTEXTSEARCH_H
+
+#include <string>
+
+namespace luasqlgen
+{
+
+// Turns user input into an FTS5 query matching all words as prefixes, e.g. 'foo ba"r' becomes '"foo"* "ba""r"*'.
+// Quoting every word keeps FTS5 operators in the input from being interpreted.
+inline std::string ftsQuery(const std::string& term)
+{
+	std::string result;
+	size_t pos = 0;
+	while(true)
+	{
+		const size_t start = term.find_first_not_of(" \t\r\n", pos);
+		if(start == std::string::npos)
+			break;
+
+		pos = term.find_first_of(" \t\r\n", start);
+		const std::string word = term.substr(start, pos == std::string::npos ? std::string::npos : pos - start);
+
+		if(!result.empty()) result += ' ';
+		result += '"';
+		for(char c : word)
+		{
+			if(c == '"') result += '"';
+			result += c;
+		}
+		result += "\"*";
+
+		if(pos == std::string::npos)
+			break;
+	}
+	return result;
+}
+
+}
+
+#endif
@@ -3,6 +3,7 @@
 
 #include "DatabaseConnection.h"
 #include <mariadb++/connection.hpp>
+#include <mariadb++/exceptions.hpp>
 #include <exception>
 #include <unordered_map>
 
@@ -13,52 +14,81 @@ class MariaDBStmt : public PreparedStmt
 {
 	mariadb::connection_ref m_connection;
 	mariadb::statement_ref m_stmt;
+	bool m_columnsKnown = false;
 	
+	mariadb::result_set_ref execute()
+	{
+		try
+		{
+			mariadb::result_set_ref result = m_stmt->query();
+			if(!m_columnsKnown && result)
+				readColumns(result);
+			return result;
+		}
+		catch(const mariadb::exception::base& e)
+		{
+			// ER_LOCK_WAIT_TIMEOUT and ER_LOCK_DEADLOCK, the transaction can be retried
+			if(e.error_id() == 1205 || e.error_id() == 1213)
+				throw BusyError(e.what());
+			throw;
+		}
+	}
+
+	// mariadbpp only exposes column metadata through result sets. It only reports the kind of
+	// value of a column, so the declared types stay empty.
+	void readColumns(const mariadb::result_set_ref& result)
+	{
+		m_columns.resize(result->column_count());
+		for(unsigned int i = 0; i < m_columns.size(); i++)
+			m_columns[i].name = result->column_name(i);
+		m_columnsKnown = true;
+	}
+
 	void translateType(std::stringstream& ss, const mariadb::result_set_ref& result, size_t i)
 	{
 		switch(result->column_type(i))
 		{
 			case mariadb::value::string:
-				ss << "\"" << result->column_name(i) << "\" : \"" << jsonEscape(result->get_string(i)) << (i == result->column_count() - 1 ? "\"\n" : "\",\n");
+				ss << "\"" << m_columns[i].name << "\" : \"" << jsonEscape(result->get_string(i)) << (i == m_columns.size() - 1 ? "\"\n" : "\",\n");
 			break;
 			case mariadb::value::unsigned8:
-				ss << "\"" << result->column_name(i) << "\" : \"" << static_cast<unsigned short>(result->get_unsigned8(i)) << (i == result->column_count() - 1 ? "\"\n" : "\",\n");
+				ss << "\"" << m_columns[i].name << "\" : \"" << static_cast<unsigned short>(result->get_unsigned8(i)) << (i == m_columns.size() - 1 ? "\"\n" : "\",\n");
 			break;
 			case mariadb::value::unsigned16:
-				ss << "\"" << result->column_name(i) << "\" : \"" << result->get_unsigned16(i) << (i == result->column_count() - 1 ? "\"\n" : "\",\n");
+				ss << "\"" << m_columns[i].name << "\" : \"" << result->get_unsigned16(i) << (i == m_columns.size() - 1 ? "\"\n" : "\",\n");
 			break;
 			case mariadb::value::unsigned32:
-				ss << "\"" << result->column_name(i) << "\" : \"" << result->get_unsigned32(i) << (i == result->column_count() - 1 ? "\"\n" : "\",\n");
+				ss << "\"" << m_columns[i].name << "\" : \"" << result->get_unsigned32(i) << (i == m_columns.size() - 1 ? "\"\n" : "\",\n");
 			break;
 			case mariadb::value::unsigned64:
-				ss << "\"" << result->column_name(i) << "\" : \"" << result->get_unsigned64(i) << (i == result->column_count() - 1 ? "\"\n" : "\",\n");
+				ss << "\"" << m_columns[i].name << "\" : \"" << result->get_unsigned64(i) << (i == m_columns.size() - 1 ? "\"\n" : "\",\n");
 			break;
 			case mariadb::value::signed8:
-				ss << "\"" << result->column_name(i) << "\" : \"" << static_cast<short>(result->get_signed8(i)) << (i == result->column_count() - 1 ? "\"\n" : "\",\n");
+				ss << "\"" << m_columns[i].name << "\" : \"" << static_cast<short>(result->get_signed8(i)) << (i == m_columns.size() - 1 ? "\"\n" : "\",\n");
 			break;
 			case mariadb::value::signed16:
-				ss << "\"" << result->column_name(i) << "\" : \"" << result->get_signed16(i) << (i == result->column_count() - 1 ? "\"\n" : "\",\n");
+				ss << "\"" << m_columns[i].name << "\" : \"" << result->get_signed16(i) << (i == m_columns.size() - 1 ? "\"\n" : "\",\n");
 			break;
 			case mariadb::value::signed32:
-				ss << "\"" << result->column_name(i) << "\" : \"" << result->get_signed32(i) << (i == result->column_count() - 1 ? "\"\n" : "\",\n");
+				ss << "\"" << m_columns[i].name << "\" : \"" << result->get_signed32(i) << (i == m_columns.size() - 1 ? "\"\n" : "\",\n");
 			break;
 			case mariadb::value::signed64:
-				ss << "\"" << result->column_name(i) << "\" : \"" << result->get_signed64(i) << (i == result->column_count() - 1 ? "\"\n" : "\",\n");
+				ss << "\"" << m_columns[i].name << "\" : \"" << result->get_signed64(i) << (i == m_columns.size() - 1 ? "\"\n" : "\",\n");
 			break;
 			case mariadb::value::float32:
-				ss << "\"" << result->column_name(i) << "\" : \"" << result->get_float(i) << (i == result->column_count() - 1 ? "\"\n" : "\",\n");
+				ss << "\"" << m_columns[i].name << "\" : \"" << result->get_float(i) << (i == m_columns.size() - 1 ? "\"\n" : "\",\n");
 			break;
 			
 			case mariadb::value::decimal:
-				ss << "\"" << result->column_name(i) << "\" : \"" << result->get_decimal(i).double64() << (i == result->column_count() - 1 ? "\"\n" : "\",\n");
+				ss << "\"" << m_columns[i].name << "\" : \"" << result->get_decimal(i).double64() << (i == m_columns.size() - 1 ? "\"\n" : "\",\n");
 			break;
 			
 			case mariadb::value::double64:
-				ss << "\"" << result->column_name(i) << "\" : \"" << result->get_double(i) << (i == result->column_count() - 1 ? "\"\n" : "\",\n");
+				ss << "\"" << m_columns[i].name << "\" : \"" << result->get_double(i) << (i == m_columns.size() - 1 ? "\"\n" : "\",\n");
 			break;
 
 			case mariadb::value::blob:
-				ss << "\"" << result->column_name(i) << "\" : \"" << jsonEscape(result->get_string(i)) << (i == result->column_count() - 1 ? "\"\n" : "\",\n");
+				ss << "\"" << m_columns[i].name << "\" : \"" << jsonEscape(result->get_string(i)) << (i == m_columns.size() - 1 ? "\"\n" : "\",\n");
 			break;
 
 			default: throw std::runtime_error(std::string("Received unknown type from MariaDB! (") 
@@ -95,11 +125,11 @@ class MariaDBStmt : public PreparedStmt
 			case mariadb::value::signed64:
 				return std::to_string(result->get_signed64(i));
 			case mariadb::value::float32:
-				return std::to_string(result->get_float(i));
+				return realToString(result->get_float(i));
 			case mariadb::value::double64:
-				return std::to_string(result->get_double(i));
+				return realToString(result->get_double(i));
 			case mariadb::value::decimal:
-				return std::to_string(result->get_decimal(i).double64());
+				return result->get_decimal(i).str();
 			
 			default: throw std::runtime_error(std::string("Received unknown type from MariaDB! (") 
 				+ result->column_name(i) + " is "
@@ -107,6 +137,21 @@ class MariaDBStmt : public PreparedStmt
 		}	
 	}
 	
+	void readRows(DatabaseResult& dbresult)
+	{
+		mariadb::result_set_ref result = execute();
+		for(unsigned int j = 0; j < result->row_count() && result->next(); j++)
+		{
+			std::unordered_map<std::string, std::string> row;
+			row.reserve(m_columns.size());
+			for(unsigned int i = 0; i < m_columns.size(); i++)
+			{
+				row[m_columns[i].name] = toString(result, i);
+			}
+			dbresult.push_back(std::move(row));
+		}
+	}
+
 public:
 	MariaDBStmt(const mariadb::connection_ref& conn):
 		m_connection(conn) {}
@@ -120,11 +165,11 @@ public:
 		
 		std::stringstream ss;
 
-		mariadb::result_set_ref result = m_stmt->query();
+		mariadb::result_set_ref result = execute();
 		for(unsigned int j = 0; j < result->row_count() && result->next(); j++)
 		{
 			ss << "{\n";
-			for(unsigned int i = 0; i < result->column_count(); i++)
+			for(unsigned int i = 0; i < m_columns.size(); i++)
 			{
 				translateType(ss, result, i);
 			}
@@ -144,11 +189,11 @@ public:
 		if(!m_stmt) build();
 		std::stringstream ss;
 	
-		mariadb::result_set_ref result = m_stmt->query();
+		mariadb::result_set_ref result = execute();
 		for(unsigned int j = 0; j < result->row_count() && result->next(); j++)
 		{
 			ss << "{\n";
-			for(unsigned int i = 0; i < result->column_count(); i++)
+			for(unsigned int i = 0; i < m_columns.size(); i++)
 			{
 				translateType(ss, result, i);
 			}
@@ -165,7 +210,7 @@ public:
 	void query() override
 	{
 		if(!m_stmt) build();
-		m_stmt->query();
+		execute();
 	}
 	
 	void query(const std::vector<std::string>& args, DatabaseResult& dbresult) override
@@ -175,21 +220,49 @@ public:
 		for(size_t i = 0; i < args.size(); i++)
 			m_stmt->set_string(i, args[i]);
 		
-		mariadb::result_set_ref result = m_stmt->query();
-		for(unsigned int j = 0; j < result->row_count() && result->next(); j++)
+		readRows(dbresult);
+	}
+
+	// Binds numbers with their types, e.g. for "limit ?" which does not accept strings
+	void queryRef(const ArgViews& args, DatabaseResult& dbresult)
+	{
+		if(!m_stmt) build();
+
+		for(size_t i = 0; i < args.size(); i++)
 		{
-			std::unordered_map<std::string, std::string> row;
-			for(unsigned int i = 0; i < result->column_count(); i++)
+			const ArgView& arg = args[i];
+			switch(arg.type)
 			{
-				row[result->column_name(i)] = toString(result, i);
+				case ARG_INTEGER: m_stmt->set_signed64(i, arg.integer); break;
+				case ARG_UNSIGNED: m_stmt->set_unsigned64(i, static_cast<uint64_t>(arg.integer)); break;
+				case ARG_REAL: m_stmt->set_double(i, arg.real); break;
+				default: m_stmt->set_string(i, std::string(arg.data)); break;
 			}
-			dbresult.push_back(std::move(row));
 		}
+
+		readRows(dbresult);
 	}
-	
+
+	bool queryScalar(const std::vector<std::string>& args, std::string& value) override
+	{
+		if(!m_stmt) build();
+
+		for(size_t i = 0; i < args.size(); i++)
+			m_stmt->set_string(i, args[i]);
+
+		mariadb::result_set_ref result = execute();
+		if(!result->next() || result->get_is_null(0))
+			return false;
+
+		value = toString(result, 0);
+		return true;
+	}
+
 	void build() override
 	{
 		m_stmt = m_connection->create_statement(getSource());
+		m_columns.clear();
+		m_columnsKnown = false;
 	}
 };
 	
@@ -239,6 +312,11 @@ public:
 	}
 	
 	std::shared_ptr<PreparedStmt> getCachedStmt(const std::string& source)
+	{
+		return getMariaDBStmt(source);
+	}
+
+	std::shared_ptr<MariaDBStmt> getMariaDBStmt(const std::string& source)
 	{
 		auto stmtIter = m_stmtCache.find(source);
 		if(stmtIter == m_stmtCache.end())
@@ -264,6 +342,12 @@ public:
 		reconnect();
 		return getCachedStmt(query)->queryJson();
 	}
+
+	bool queryScalar(const std::string& query, const std::vector<std::string>& args, std::string& value) override
+	{
+		reconnect();
+		return getCachedStmt(query)->queryScalar(args, value);
+	}
 	
 	void query(const std::string& q) override
 	{
@@ -276,6 +360,13 @@ public:
 		reconnect();
 		getCachedStmt(query)->query(args, result);
 	}
+
+	void queryRef(const std::string& query, const ArgViews& args, DatabaseResult& result) override
+	{
+		reconnect();
+		getMariaDBStmt(query)->queryRef(args, result);
+	}
+	using DatabaseConnection::queryRef;
 	
 	void execute(const std::string & file) override
 	{
@@ -304,6 +395,7 @@ public:
 	
 	const char* getName() const override { return "MariaDB"; }
 	DBTYPE getType() const override { return MARIADB; }
+	size_t getBatchSize() const override { return 1000; }
 };
 
 }
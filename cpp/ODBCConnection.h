@@ -97,33 +97,23 @@ public:
 		query();
 		
 		std::stringstream ss;
-		SQLSMALLINT cols;
-				
-		if(SQLNumResultCols(m_stmt, &cols) != SQL_SUCCESS)
-			throwODBCError("Could not determine the number of columns: ", m_sql, m_db, m_stmt);
+		const SQLSMALLINT cols = m_columns.size();
 		
 		SQLRETURN ret;
 		std::vector<SQLCHAR> dataBuf(4096);
-		SQLCHAR colName[256];
 		
-		while((ret = SQLFetch(m_stmt)) == SQL_SUCCESS)
+		// SQL_SUCCESS_WITH_INFO still delivers a row, e.g. with a warning from the driver
+		while(SQL_SUCCEEDED(ret = SQLFetch(m_stmt)))
 		{
-			ResultLine entry;
 			ss << "{\n";
 			for(SQLSMALLINT i = 0; i < cols; i++)
 			{
-				if(SQLDescribeCol(m_stmt, i+1, colName, sizeof(colName),
-					       nullptr, nullptr, nullptr, nullptr, nullptr) != SQL_SUCCESS)
-				{
-					throwODBCError("Could not get column name: ", m_sql, m_db, m_stmt);
-				}
-				
 				if(SQLGetData(m_stmt, i+1, SQL_CHAR, dataBuf.data(), dataBuf.size(), nullptr) != SQL_SUCCESS)
 				{
 					throwODBCError("Could not get column name: ", m_sql, m_db, m_stmt);
 				}
 				
-				ss << "\"" << (char*) colName << "\":\"" << jsonEscape((char*) dataBuf.data()) << "\"";
+				ss << "\"" << m_columns[i].name << "\":\"" << jsonEscape((char*) dataBuf.data()) << "\"";
 				if(i < cols-1)
 					ss << ",";
 				
@@ -134,6 +124,8 @@ public:
 		}
 		
 		SQLFreeStmt(m_stmt, SQL_CLOSE);
+		if(ret != SQL_NO_DATA)
+			throwODBCError("Could not fetch row: ", m_sql, m_db, m_stmt);
 		
 		std::string resultStr = ss.str();
 		if(!resultStr.empty())
@@ -154,42 +146,82 @@ public:
 		bindArgs(args);
 		query();
 		
-		SQLSMALLINT cols;
-				
-		if(SQLNumResultCols(m_stmt, &cols) != SQL_SUCCESS)
-			throwODBCError("Could not determine the number of columns: ", m_sql, m_db, m_stmt);
-		
+		const SQLSMALLINT cols = m_columns.size();
 		dbresult.reserve(32);
 		
 		SQLRETURN ret;
 		std::vector<SQLCHAR> dataBuf(4096);
-		SQLCHAR colName[256];
 		
-		while((ret = SQLFetch(m_stmt)) == SQL_SUCCESS)
+		while(SQL_SUCCEEDED(ret = SQLFetch(m_stmt)))
 		{
 			ResultLine entry;
+			entry.reserve(cols);
 			for(SQLSMALLINT i = 0; i < cols; i++)
 			{
-				if(SQLDescribeCol(m_stmt, i+1, colName, sizeof(colName),
-					       nullptr, nullptr, nullptr, nullptr, nullptr) != SQL_SUCCESS)
-				{
-					throwODBCError("Could not get column name: ", m_sql, m_db, m_stmt);
-				}
-				
 				if(SQLGetData(m_stmt, i+1, SQL_CHAR, dataBuf.data(), dataBuf.size(), nullptr) != SQL_SUCCESS)
 				{
 					throwODBCError("Could not get column name: ", m_sql, m_db, m_stmt);
 				}
 				
-				entry[std::string((char*) colName)] = std::string((char*) dataBuf.data());
+				entry[m_columns[i].name] = std::string((char*) dataBuf.data());
 			}
 			
 			dbresult.push_back(std::move(entry));
 		}
 		
 		SQLFreeStmt(m_stmt, SQL_CLOSE);
+		if(ret != SQL_NO_DATA)
+			throwODBCError("Could not fetch row: ", m_sql, m_db, m_stmt);
 	}
 	
+	bool queryScalar(const std::vector<std::string>& args, std::string& value) override
+	{
+		if(!m_stmt) build();
+		bindArgs(args);
+		query();
+
+		bool found = false;
+		if(SQL_SUCCEEDED(SQLFetch(m_stmt)))
+		{
+			// Long values are read in parts, the length indicator tells how much is left
+			std::vector<SQLCHAR> dataBuf(256);
+			std::string data;
+			while(true)
+			{
+				SQLLEN length = 0;
+				const SQLRETURN rc = SQLGetData(m_stmt, 1, SQL_CHAR, dataBuf.data(), dataBuf.size(), &length);
+				if(rc == SQL_NO_DATA)
+					break;
+
+				if(rc != SQL_SUCCESS && rc != SQL_SUCCESS_WITH_INFO)
+				{
+					SQLFreeStmt(m_stmt, SQL_CLOSE);
+					throwODBCError("Could not get column data: ", m_sql, m_db, m_stmt);
+				}
+
+				if(length == SQL_NULL_DATA)
+					break;
+
+				found = true;
+				const SQLLEN available = dataBuf.size() - 1; // The driver always terminates with a NUL
+				if(length != SQL_NO_TOTAL && length <= available)
+				{
+					data.append((char*) dataBuf.data(), length);
+					break;
+				}
+
+				data.append((char*) dataBuf.data(), available);
+				dataBuf.resize(length == SQL_NO_TOTAL ? dataBuf.size() * 2 : length - available + 1);
+			}
+
+			if(found)
+				value = std::move(data);
+		}
+
+		SQLFreeStmt(m_stmt, SQL_CLOSE);
+		return found;
+	}
+
 	void build() override
 	{
 		if(SQLAllocStmt(m_db, &m_stmt) != SQL_SUCCESS)
@@ -197,6 +229,29 @@ public:
 		
 		if(SQLPrepare(m_stmt, (unsigned char*) getSource().c_str(), SQL_NTS) != SQL_SUCCESS)
 			throwODBCError("Could not prepare statement: ", m_sql, m_db, m_stmt);
+
+		// Prepared statements already describe their result columns
+		SQLSMALLINT cols = 0;
+		if(SQLNumResultCols(m_stmt, &cols) != SQL_SUCCESS)
+			throwODBCError("Could not determine the number of columns: ", m_sql, m_db, m_stmt);
+
+		m_columns.resize(cols);
+		for(SQLSMALLINT i = 0; i < cols; i++)
+		{
+			SQLCHAR colName[256];
+			SQLCHAR typeName[128];
+			SQLSMALLINT typeLength = 0;
+
+			if(SQLDescribeCol(m_stmt, i+1, colName, sizeof(colName),
+				       nullptr, nullptr, nullptr, nullptr, nullptr) != SQL_SUCCESS)
+			{
+				throwODBCError("Could not get column name: ", m_sql, m_db, m_stmt);
+			}
+
+			m_columns[i].name = (char*) colName;
+			if(SQL_SUCCEEDED(SQLColAttribute(m_stmt, i+1, SQL_DESC_TYPE_NAME, typeName, sizeof(typeName), &typeLength, nullptr)))
+				m_columns[i].declType = (char*) typeName;
+		}
 	}
 };
 	
@@ -292,6 +347,12 @@ public:
 		reconnect();
 		return getCachedStmt(query)->queryJson();
 	}
+
+	bool queryScalar(const std::string& query, const std::vector<std::string>& args, std::string& value) override
+	{
+		reconnect();
+		return getCachedStmt(query)->queryScalar(args, value);
+	}
 	
 	void query(const std::string& q) override
 	{
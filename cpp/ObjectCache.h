@@ -0,0 +1,169 @@
+#ifndef LUASQLGEN_OBJECTCACHE_H
+#define LUASQLGEN_OBJECTCACHE_H
+
+#include <list>
+#include <algorithm>
+#include <vector>
+#include <memory>
+#include <unordered_map>
+#include <functional>
+#include <mutex>
+#include <atomic>
+
+namespace luasqlgen
+{
+
+struct CacheStats
+{
+	unsigned long long hits = 0;
+	unsigned long long misses = 0;
+	unsigned long long evictions = 0;
+	size_t entries = 0;
+
+	// Estimated memory held by the cached objects in bytes
+	size_t memory = 0;
+
+	double hitRate() const { return hits + misses ? double(hits) / (hits + misses) : 0.0; }
+};
+
+/**
+ * Size bounded cache of objects by id, used by the generated get functions.
+ *
+ * Ids are distributed over independently locked shards so concurrent readers rarely
+ * contend. Every shard evicts its least recently used entry once it is full.
+ */
+template<typename T>
+class ObjectCache
+{
+	struct Entry
+	{
+		unsigned long long id;
+		T object;
+		size_t size;
+	};
+
+	struct Shard
+	{
+		std::mutex mutex;
+		std::list<Entry> entries; // Most recently used first
+		std::unordered_map<unsigned long long, typename std::list<Entry>::iterator> index;
+		size_t memory = 0;
+	};
+
+	std::vector<std::unique_ptr<Shard>> m_shards;
+	size_t m_shardCapacity;
+	std::function<size_t(const T&)> m_sizeOf;
+
+	std::atomic<unsigned long long> m_hits{0};
+	std::atomic<unsigned long long> m_misses{0};
+	std::atomic<unsigned long long> m_evictions{0};
+
+	Shard& shard(unsigned long long id) { return *m_shards[id % m_shards.size()]; }
+
+public:
+	ObjectCache(size_t capacity, size_t shards = 16, std::function<size_t(const T&)> sizeOf = nullptr):
+		m_sizeOf(std::move(sizeOf))
+	{
+		if(!shards) shards = 1;
+		m_shardCapacity = std::max<size_t>(1, (capacity + shards - 1) / shards);
+
+		m_shards.reserve(shards);
+		for(size_t i = 0; i < shards; i++)
+			m_shards.emplace_back(new Shard);
+	}
+
+	bool get(unsigned long long id, T& out)
+	{
+		Shard& s = shard(id);
+		std::lock_guard<std::mutex> lock(s.mutex);
+
+		auto iter = s.index.find(id);
+		if(iter == s.index.end())
+		{
+			m_misses++;
+			return false;
+		}
+
+		s.entries.splice(s.entries.begin(), s.entries, iter->second);
+		out = iter->second->object;
+		m_hits++;
+		return true;
+	}
+
+	void put(unsigned long long id, const T& object)
+	{
+		const size_t size = m_sizeOf ? m_sizeOf(object) : sizeof(T);
+
+		Shard& s = shard(id);
+		std::lock_guard<std::mutex> lock(s.mutex);
+
+		auto iter = s.index.find(id);
+		if(iter != s.index.end())
+		{
+			s.memory -= iter->second->size;
+			iter->second->object = object;
+			iter->second->size = size;
+			s.memory += size;
+			s.entries.splice(s.entries.begin(), s.entries, iter->second);
+			return;
+		}
+
+		if(s.entries.size() >= m_shardCapacity)
+		{
+			s.memory -= s.entries.back().size;
+			s.index.erase(s.entries.back().id);
+			s.entries.pop_back();
+			m_evictions++;
+		}
+
+		s.entries.push_front(Entry{id, object, size});
+		s.index[id] = s.entries.begin();
+		s.memory += size;
+	}
+
+	void erase(unsigned long long id)
+	{
+		Shard& s = shard(id);
+		std::lock_guard<std::mutex> lock(s.mutex);
+
+		auto iter = s.index.find(id);
+		if(iter == s.index.end())
+			return;
+
+		s.memory -= iter->second->size;
+		s.entries.erase(iter->second);
+		s.index.erase(iter);
+	}
+
+	void clear()
+	{
+		for(auto& s : m_shards)
+		{
+			std::lock_guard<std::mutex> lock(s->mutex);
+			s->entries.clear();
+			s->index.clear();
+			s->memory = 0;
+		}
+	}
+
+	CacheStats getStats() const
+	{
+		CacheStats stats;
+		stats.hits = m_hits;
+		stats.misses = m_misses;
+		stats.evictions = m_evictions;
+
+		for(auto& s : m_shards)
+		{
+			std::lock_guard<std::mutex> lock(s->mutex);
+			stats.entries += s->entries.size();
+			stats.memory += s->memory;
+		}
+
+		return stats;
+	}
+};
+
+}
+
+#endif
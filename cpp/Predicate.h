@@ -0,0 +1,108 @@
+#ifndef LUASQLGEN_PREDICATE_H
+#define LUASQLGEN_PREDICATE_H
+
+#include "DatabaseConnection.h"
+
+namespace luasqlgen
+{
+
+// Sort order of paginated queries
+enum ORDER
+{
+	ASCENDING = 0,
+	DESCENDING
+};
+
+/**
+ * Conjunction of conditions on columns of one table, used by the generated typed predicate
+ * builders (<T>Predicate).
+ *
+ * The SQL text only depends on which conditions were added (the "shape"), values are always
+ * bound as arguments. Every shape therefore maps to exactly one cached prepared statement.
+ * To keep the number of shapes small, "in" lists are padded to the next power of two by
+ * repeating their last value.
+ */
+class Predicate
+{
+	std::string m_sql;
+	std::vector<std::string> m_args;
+
+	void append(const char* column, const std::string& condition)
+	{
+		if(!m_sql.empty())
+			m_sql += " and ";
+
+		m_sql += "`";
+		m_sql += column;
+		m_sql += "` ";
+		m_sql += condition;
+	}
+
+protected:
+	void add(const char* column, const char* op, const std::string& value)
+	{
+		append(column, std::string(op) + " ?");
+		m_args.push_back(value);
+	}
+
+	// Adds a raw SQL condition, e.g. calling a function registered with SQLiteConnection::createFunction.
+	// The expression is part of the statement text and must never contain user input, use '?' and args instead.
+	void addExpression(const std::string& expression, const std::vector<std::string>& args)
+	{
+		if(!m_sql.empty())
+			m_sql += " and ";
+
+		m_sql += "(" + expression + ")";
+		m_args.insert(m_args.end(), args.begin(), args.end());
+	}
+
+	void addBetween(const char* column, const std::string& low, const std::string& high)
+	{
+		append(column, "between ? and ?");
+		m_args.push_back(low);
+		m_args.push_back(high);
+	}
+
+	template<typename T>
+	void addIn(const char* column, const std::vector<T>& values)
+	{
+		std::vector<std::string> args;
+		args.reserve(values.size());
+		for(const auto& value : values)
+			args.push_back(std::to_string(value));
+		addIn(column, args);
+	}
+
+	void addIn(const char* column, const std::vector<std::string>& values)
+	{
+		if(values.empty())
+		{
+			// Nothing can match an empty list
+			if(!m_sql.empty()) m_sql += " and ";
+			m_sql += "0 = 1";
+			return;
+		}
+
+		size_t count = 1;
+		while(count < values.size())
+			count <<= 1;
+
+		append(column, "in (" + makePlaceholders(count) + ")");
+		m_args.insert(m_args.end(), values.begin(), values.end());
+		m_args.insert(m_args.end(), count - values.size(), values.back());
+	}
+
+public:
+	bool empty() const { return m_sql.empty(); }
+
+	// The condition without "where", empty if no condition was added.
+	const std::string& getSql() const { return m_sql; }
+	const std::vector<std::string>& getArgs() const { return m_args; }
+
+	// The where clause including a leading space or an empty string.
+	std::string where() const { return m_sql.empty() ? std::string() : " where " + m_sql; }
+};
+
+}
+
+#endif
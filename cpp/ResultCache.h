@@ -0,0 +1,148 @@
+#ifndef LUASQLGEN_RESULTCACHE_H
+#define LUASQLGEN_RESULTCACHE_H
+
+#include "ObjectCache.h"
+#include <string>
+#include <chrono>
+
+namespace luasqlgen
+{
+
+/**
+ * Cache for the JSON results of generated script functions, keyed by script and arguments.
+ *
+ * Every table has a version counter which the generated write functions increase. An entry
+ * remembers the versions of the tables its script reads and is stale as soon as one of them
+ * changed. Writes from other processes are not noticed, they only become visible once an
+ * entry is older than the TTL.
+ */
+class ResultCache
+{
+	struct Entry
+	{
+		std::string key;
+		std::string value;
+		std::vector<unsigned long long> versions;
+		std::chrono::steady_clock::time_point expires;
+	};
+
+	std::mutex m_mutex;
+	std::list<Entry> m_entries; // Most recently used first
+	std::unordered_map<std::string, std::list<Entry>::iterator> m_index;
+	std::vector<unsigned long long> m_tableVersions;
+	std::chrono::milliseconds m_ttl;
+	size_t m_capacity;
+	size_t m_memory = 0;
+	CacheStats m_stats;
+
+	void remove(std::list<Entry>::iterator entry)
+	{
+		m_memory -= entry->key.size() + entry->value.size();
+		m_index.erase(entry->key);
+		m_entries.erase(entry);
+	}
+
+public:
+	ResultCache(size_t tableCount, std::chrono::milliseconds ttl, size_t capacity = 1024):
+		m_tableVersions(tableCount), m_ttl(ttl), m_capacity(std::max<size_t>(1, capacity)) {}
+
+	// Builds an unambiguous key from the script name and its arguments.
+	static std::string makeKey(const char* script, const std::vector<std::string>& args)
+	{
+		std::string key = script;
+		for(const auto& arg : args)
+		{
+			key += '\0';
+			key += std::to_string(arg.size());
+			key += ':';
+			key += arg;
+		}
+		return key;
+	}
+
+	void touch(size_t table)
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_tableVersions[table]++;
+	}
+
+	// Versions of the given tables, taken before running a script so concurrent writes are not missed.
+	std::vector<unsigned long long> getVersions(const std::vector<size_t>& tables)
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		std::vector<unsigned long long> versions;
+		versions.reserve(tables.size());
+		for(auto table : tables)
+			versions.push_back(m_tableVersions[table]);
+		return versions;
+	}
+
+	bool get(const std::string& key, const std::vector<size_t>& tables, std::string& out)
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+
+		auto iter = m_index.find(key);
+		if(iter == m_index.end())
+		{
+			m_stats.misses++;
+			return false;
+		}
+
+		auto entry = iter->second;
+		bool valid = std::chrono::steady_clock::now() < entry->expires;
+		for(size_t i = 0; valid && i < tables.size(); i++)
+			valid = entry->versions[i] == m_tableVersions[tables[i]];
+
+		if(!valid)
+		{
+			remove(entry);
+			m_stats.misses++;
+			return false;
+		}
+
+		m_entries.splice(m_entries.begin(), m_entries, entry);
+		out = entry->value;
+		m_stats.hits++;
+		return true;
+	}
+
+	void put(const std::string& key, std::vector<unsigned long long> versions, const std::string& value)
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+
+		auto iter = m_index.find(key);
+		if(iter != m_index.end())
+			remove(iter->second);
+
+		if(m_entries.size() >= m_capacity)
+		{
+			remove(std::prev(m_entries.end()));
+			m_stats.evictions++;
+		}
+
+		m_entries.push_front(Entry{key, value, std::move(versions), std::chrono::steady_clock::now() + m_ttl});
+		m_index[key] = m_entries.begin();
+		m_memory += key.size() + value.size();
+	}
+
+	void clear()
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_entries.clear();
+		m_index.clear();
+		m_memory = 0;
+	}
+
+	CacheStats getStats()
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		CacheStats stats = m_stats;
+		stats.entries = m_entries.size();
+		stats.memory = m_memory;
+		return stats;
+	}
+};
+
+}
+
+#endif
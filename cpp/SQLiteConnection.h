@@ -5,81 +5,424 @@
 #include <sqlite3.h>
 #include <exception>
 #include <sstream>
+#include <iostream>
+#include <cstring>
 #include <unordered_map>
+#include <list>
+#include <functional>
+#include <optional>
+#include <tuple>
+#include <utility>
+#include <chrono>
+#include <thread>
 
 namespace luasqlgen
 {
 
+enum SQLITE_PROFILE
+{
+	PROFILE_DEFAULT = 0, // SQLite defaults, only WAL and the busy timeout are set
+	PROFILE_READ_HEAVY,
+	PROFILE_INGEST,
+	PROFILE_LOW_MEMORY
+};
+
+enum SQLITE_THREADING
+{
+	THREADING_DEFAULT = 0, // Whatever SQLite was compiled with, usually serialized
+	THREADING_SINGLE, // No mutexes at all, only possible for the whole process
+	THREADING_MULTI, // No connection mutex, every connection is used by one thread at a time
+	THREADING_SERIALIZED // Connections may be shared between threads
+};
+
+// Pragmas applied by a tuning profile. Zero or null values leave the SQLite default untouched.
+struct SQLiteProfile
+{
+	const char* name;
+	const char* synchronous; // OFF, NORMAL or FULL
+	long long mmapSize; // Bytes, -1 disables memory mapping
+	int cacheSize; // Negative values are KiB, positive values pages
+	const char* tempStore; // FILE or MEMORY
+	int walAutocheckpoint; // Pages
+	int pageSize; // Only has an effect on new databases
+};
+
+inline const SQLiteProfile& getSQLiteProfile(SQLITE_PROFILE profile)
+{
+	static const SQLiteProfile profiles[] = {
+		{"default", nullptr, 0, 0, nullptr, 0, 0},
+		{"read-heavy", "NORMAL", 256ll << 20, -65536, "MEMORY", 1000, 4096},
+		{"ingest", "NORMAL", 64ll << 20, -131072, "MEMORY", 10000, 8192},
+		{"low-memory", "NORMAL", -1, -512, "FILE", 1000, 4096}
+	};
+
+	return profiles[profile];
+}
+
+// Settings in effect on a connection and its memory use as reported by sqlite3_db_status.
+struct SQLiteStatus
+{
+	std::string journalMode;
+	int synchronous = 0; // 0 = OFF, 1 = NORMAL, 2 = FULL, 3 = EXTRA
+	long long mmapSize = 0;
+	long long cacheSize = 0;
+	int tempStore = 0; // 0 = DEFAULT, 1 = FILE, 2 = MEMORY
+	int walAutocheckpoint = 0;
+	int pageSize = 0;
+
+	int cacheUsed = 0; // Bytes
+	int cacheHit = 0;
+	int cacheMiss = 0;
+	int cacheWrite = 0;
+	int schemaUsed = 0; // Bytes
+	int stmtUsed = 0; // Bytes
+};
+
+// Counters of a prepared statement since it was built or last reset, see sqlite3_stmt_status.
+struct SQLiteStmtStatus
+{
+	int fullscanSteps = 0; // Rows visited by full table scans, a missing index shows up here
+	int sorts = 0;
+	int autoindex = 0; // Rows inserted into automatic indexes
+	int vmSteps = 0;
+	int reprepares = 0; // Since the statement was prepared, only counted by SQLite 3.20 and later
+	int runs = 0; // Only counted by SQLite 3.20 and later
+};
+
+// Outcome of an online backup or restore
+struct BackupStats
+{
+	int pages = 0; // Size of the copied database
+	int steps = 0;
+	int busy = 0; // Steps which had to wait for a lock held by another connection
+	std::chrono::microseconds duration{0};
+};
+
+#if SQLITE_VERSION_NUMBER >= 3020000
+const unsigned int PREPARE_PERSISTENT = SQLITE_PREPARE_PERSISTENT;
+#else
+const unsigned int PREPARE_PERSISTENT = 0;
+#endif
+
+namespace
+{
+void throwSQLiteError(int rc, const std::string& msg)
+{
+	const int primary = rc & 0xff;
+	if(primary == SQLITE_BUSY || primary == SQLITE_LOCKED)
+		throw BusyError(msg);
+
+	throw std::runtime_error(msg);
+}
+
+// Conversions between SQLite values and the C++ types of user defined functions. NULL arguments become 0 or empty.
+inline void getArg(sqlite3_value* value, std::string& out)
+{
+	const char* text = reinterpret_cast<const char*>(sqlite3_value_text(value));
+	out.assign(text ? text : "", sqlite3_value_bytes(value));
+}
+
+inline void getArg(sqlite3_value* value, Blob& out)
+{
+	const std::byte* data = static_cast<const std::byte*>(sqlite3_value_blob(value));
+	out.assign(data, data + (data ? sqlite3_value_bytes(value) : 0));
+}
+
+template<typename T, typename std::enable_if<std::is_integral<T>::value, int>::type = 0>
+void getArg(sqlite3_value* value, T& out) { out = static_cast<T>(sqlite3_value_int64(value)); }
+
+template<typename T, typename std::enable_if<std::is_floating_point<T>::value, int>::type = 0>
+void getArg(sqlite3_value* value, T& out) { out = static_cast<T>(sqlite3_value_double(value)); }
+
+inline void setResult(sqlite3_context* ctx, const std::string& value)
+{
+	sqlite3_result_text(ctx, value.data(), value.size(), SQLITE_TRANSIENT);
+}
+
+inline void setResult(sqlite3_context* ctx, const Blob& value)
+{
+	sqlite3_result_blob(ctx, value.data(), value.size(), SQLITE_TRANSIENT);
+}
+
+template<typename T, typename std::enable_if<std::is_integral<T>::value, int>::type = 0>
+void setResult(sqlite3_context* ctx, T value) { sqlite3_result_int64(ctx, static_cast<sqlite3_int64>(value)); }
+
+template<typename T, typename std::enable_if<std::is_floating_point<T>::value, int>::type = 0>
+void setResult(sqlite3_context* ctx, T value) { sqlite3_result_double(ctx, value); }
+
+// Empty optionals are returned as NULL
+template<typename T>
+void setResult(sqlite3_context* ctx, const std::optional<T>& value)
+{
+	if(value)
+		setResult(ctx, *value);
+	else
+		sqlite3_result_null(ctx);
+}
+
+template<typename... Args, size_t... I>
+std::tuple<typename std::decay<Args>::type...> getArgs(sqlite3_value** argv, std::index_sequence<I...>)
+{
+	std::tuple<typename std::decay<Args>::type...> args;
+	(getArg(argv[I], std::get<I>(args)), ...);
+	return args;
+}
+
+template<typename R, typename... Args>
+struct ScalarFunction
+{
+	std::function<R(Args...)> function;
+
+	static void call(sqlite3_context* ctx, int, sqlite3_value** argv)
+	{
+		try
+		{
+			auto self = static_cast<ScalarFunction*>(sqlite3_user_data(ctx));
+			auto args = getArgs<Args...>(argv, std::index_sequence_for<Args...>());
+			setResult(ctx, std::apply(self->function, args));
+		}
+		catch(const std::exception& e)
+		{
+			sqlite3_result_error(ctx, e.what(), -1);
+		}
+	}
+
+	static void destroy(void* self) { delete static_cast<ScalarFunction*>(self); }
+};
+
+// Every group gets its own instance of A, created by the first step and deleted by final
+template<typename A, typename... Args>
+struct AggregateFunction
+{
+	static A** instance(sqlite3_context* ctx, bool create)
+	{
+		return static_cast<A**>(sqlite3_aggregate_context(ctx, create ? sizeof(A*) : 0));
+	}
+
+	static void step(sqlite3_context* ctx, int, sqlite3_value** argv)
+	{
+		try
+		{
+			A** aggregate = instance(ctx, true);
+			if(!aggregate)
+			{
+				sqlite3_result_error_nomem(ctx);
+				return;
+			}
+
+			if(!*aggregate)
+				*aggregate = new A();
+
+			auto args = getArgs<Args...>(argv, std::index_sequence_for<Args...>());
+			std::apply([aggregate](auto&... values) { (*aggregate)->step(values...); }, args);
+		}
+		catch(const std::exception& e)
+		{
+			sqlite3_result_error(ctx, e.what(), -1);
+		}
+	}
+
+	static void final(sqlite3_context* ctx)
+	{
+		A** aggregate = instance(ctx, false);
+		std::unique_ptr<A> owner(aggregate ? *aggregate : nullptr);
+
+		try
+		{
+			// Without any row step was never called
+			setResult(ctx, owner ? owner->finish() : A().finish());
+		}
+		catch(const std::exception& e)
+		{
+			sqlite3_result_error(ctx, e.what(), -1);
+		}
+	}
+};
+}
+
+// Clears all bindings when leaving the scope, so a statement never keeps pointers to arguments
+// bound with SQLITE_STATIC after the call which bound them returned.
+class BindingGuard
+{
+	sqlite3_stmt* m_stmt;
+
+public:
+	BindingGuard(sqlite3_stmt* stmt): m_stmt(stmt) {}
+	~BindingGuard() { sqlite3_clear_bindings(m_stmt); }
+
+	BindingGuard(const BindingGuard&) = delete;
+	BindingGuard& operator=(const BindingGuard&) = delete;
+};
+
 class SQLiteStmt : public PreparedStmt
 {
 	sqlite3_stmt* m_stmt = nullptr;
 	sqlite3* m_database = nullptr;
-public:
-	SQLiteStmt(sqlite3* db) : m_database(db) {}
-	~SQLiteStmt() { if(m_stmt) { sqlite3_finalize(m_stmt); }}
-	
-	std::string queryJson(const std::vector<std::string> & args) override
+	unsigned int m_prepareFlags = 0;
+	int m_reprepares = 0;
+
+	void bind(const ArgViews& args)
 	{
-		if(!m_stmt) throw std::runtime_error("Statement was not built!");
 		for(size_t i = 0; i < args.size(); i++)
 		{
-			sqlite3_bind_text(m_stmt, i + 1, args[i].c_str(), args[i].size(), nullptr);
+			const ArgView& arg = args[i];
+			switch(arg.type)
+			{
+				case ARG_TEXT:
+					sqlite3_bind_text(m_stmt, i + 1, arg.data.data() ? arg.data.data() : "", arg.data.size(), SQLITE_STATIC);
+				break;
+
+				case ARG_BLOB:
+					if(arg.data.empty())
+						sqlite3_bind_zeroblob(m_stmt, i + 1, 0);
+					else
+						sqlite3_bind_blob(m_stmt, i + 1, arg.data.data(), arg.data.size(), SQLITE_STATIC);
+				break;
+
+				case ARG_INTEGER: sqlite3_bind_int64(m_stmt, i + 1, arg.integer); break;
+				case ARG_REAL: sqlite3_bind_double(m_stmt, i + 1, arg.real); break;
+
+				case ARG_UNSIGNED:
+				{
+					const std::string text = arg.toString();
+					sqlite3_bind_text(m_stmt, i + 1, text.c_str(), text.size(), SQLITE_TRANSIENT);
+				}
+				break;
+			}
 		}
+	}
 
-		std::stringstream ss;
-		size_t colnum = sqlite3_column_count(m_stmt);
+	int prepare(const char* source, const char** tail)
+	{
+#if SQLITE_VERSION_NUMBER >= 3020000
+		return sqlite3_prepare_v3(m_database, source, -1, m_prepareFlags, &m_stmt, tail);
+#else
+		return sqlite3_prepare_v2(m_database, source, -1, &m_stmt, tail);
+#endif
+	}
+
+	void readColumns()
+	{
+		const int count = sqlite3_column_count(m_stmt);
+		m_columns.resize(count);
+		for(int i = 0; i < count; i++)
+		{
+			const char* declType = sqlite3_column_decltype(m_stmt, i);
+			m_columns[i].name = sqlite3_column_name(m_stmt, i);
+			m_columns[i].declType = declType ? declType : "";
+		}
+	}
+
+	// SQLite prepares statements again after schema changes, e.g. "select *" after a column was added,
+	// so the columns captured at build() may be out of date once a row was stepped.
+	void refreshColumns()
+	{
+#if SQLITE_VERSION_NUMBER >= 3020000
+		const int reprepares = sqlite3_stmt_status(m_stmt, SQLITE_STMTSTATUS_REPREPARE, 0);
+		if(reprepares != m_reprepares)
+		{
+			m_reprepares = reprepares;
+			readColumns();
+			return;
+		}
+#endif
+		if(sqlite3_column_count(m_stmt) != static_cast<int>(m_columns.size()))
+			readColumns();
+	}
+
+	void readRows(DatabaseResult& result)
+	{
+		size_t colnum = m_columns.size();
+		bool first = true;
 		int rc = 0;
 		while(true) // TODO  Maybe row limit?
 		{
 			rc = sqlite3_step(m_stmt);
 			if(rc == SQLITE_ROW)
 			{
-				ss << "{\n";
+				if(first)
+				{
+					refreshColumns();
+					colnum = m_columns.size();
+					first = false;
+				}
+
+				std::unordered_map<std::string, std::string> row;
+				row.reserve(colnum);
 				for (size_t i = 0; i < colnum; i++)
 				{
-					const char* coltext = (const char*) sqlite3_column_text(m_stmt, i);
-					ss << "\"" << sqlite3_column_name(m_stmt, i) << "\" : \"" << (coltext ? jsonEscape(coltext) : "") << (i == colnum - 1 ? "\"\n" : "\",\n");
+					std::string& value = row[m_columns[i].name];
+
+					// Sizes are taken from SQLite since blobs may contain NULs
+					const int type = sqlite3_column_type(m_stmt, i);
+					if(type == SQLITE_BLOB)
+						value.assign(static_cast<const char*>(sqlite3_column_blob(m_stmt, i)), sqlite3_column_bytes(m_stmt, i));
+					else if(type != SQLITE_NULL)
+						value.assign(reinterpret_cast<const char*>(sqlite3_column_text(m_stmt, i)), sqlite3_column_bytes(m_stmt, i));
 				}
-				
-				ss << "},\n";
+				result.push_back(std::move(row));
 			}
 			else
 			{
 				break;
 			}
+			
 		}
 
 		if(rc != SQLITE_DONE)
 		{
+			// Forces the columns to be read again with the next row
+			if(rc == SQLITE_SCHEMA)
+				m_columns.clear();
+
 			sqlite3_reset(m_stmt);
-			throw std::runtime_error(std::string("Could not execute statement:") + sqlite3_errmsg(m_database) + "\n\nWith statement\n" + getSource()); 
+			throwSQLiteError(rc, std::string("Could not execute statement:") + sqlite3_errmsg(m_database) + "\n\nWith statement\n" + getSource());
 		}
 
 		sqlite3_reset(m_stmt);
+	}
 
-		std::string result = ss.str();
-		if(!result.empty())
-			result.erase(result.end() - 2);
+public:
+	// prepareFlags are SQLITE_PREPARE_* flags, which are ignored by SQLite versions before 3.20
+	SQLiteStmt(sqlite3* db, unsigned int prepareFlags = 0) : m_database(db), m_prepareFlags(prepareFlags) {}
+	~SQLiteStmt() { if(m_stmt) { sqlite3_finalize(m_stmt); }}
+	
+	std::string queryJson(const std::vector<std::string> & args) override
+	{
+		if(!m_stmt) throw std::runtime_error("Statement was not built!");
+		BindingGuard guard(m_stmt);
+		for(size_t i = 0; i < args.size(); i++)
+		{
+			sqlite3_bind_text(m_stmt, i + 1, args[i].c_str(), args[i].size(), nullptr);
+		}
 
-		return "[\n" + result + "]\n";
+		return queryJson();
 	}
 
 	std::string queryJson() override
 	{
 		if(!m_stmt) throw std::runtime_error("Statement was not built!");
 		std::stringstream ss;
-		size_t colnum = sqlite3_column_count(m_stmt);
+		size_t colnum = m_columns.size();
+		bool first = true;
 		int rc = 0;
 		while(true) // TODO  Maybe row limit?
 		{
 			rc = sqlite3_step(m_stmt);
 			if(rc == SQLITE_ROW)
 			{
+				if(first)
+				{
+					refreshColumns();
+					colnum = m_columns.size();
+					first = false;
+				}
+
 				ss << "{\n";
 				for (size_t i = 0; i < colnum; i++)
 				{
 					const char* coltext = (const char*) sqlite3_column_text(m_stmt, i);
-					ss << "\"" << sqlite3_column_name(m_stmt, i) << "\" : \"" << (coltext ? jsonEscape(coltext) : "") << (i == colnum - 1 ? "\"\n" : "\",\n");
+					ss << "\"" << m_columns[i].name << "\" : \"" << (coltext ? jsonEscape(std::string(coltext, sqlite3_column_bytes(m_stmt, i))) : "") << (i == colnum - 1 ? "\"\n" : "\",\n");
 				}
 				
 				ss << "},\n";
@@ -92,8 +435,12 @@ public:
 
 		if(rc != SQLITE_DONE)
 		{
+			// Forces the columns to be read again with the next row
+			if(rc == SQLITE_SCHEMA)
+				m_columns.clear();
+
 			sqlite3_reset(m_stmt);
-			throw std::runtime_error(std::string("Could not execute statement:") + sqlite3_errmsg(m_database) + "\n\nWith statement\n" + getSource()); 
+			throwSQLiteError(rc, std::string("Could not execute statement:") + sqlite3_errmsg(m_database) + "\n\nWith statement\n" + getSource());
 		}
 
 		sqlite3_reset(m_stmt);
@@ -118,8 +465,12 @@ public:
 
 		if(rc != SQLITE_DONE)
 		{
+			// Forces the columns to be read again with the next row
+			if(rc == SQLITE_SCHEMA)
+				m_columns.clear();
+
 			sqlite3_reset(m_stmt);
-			throw std::runtime_error(std::string("Could not execute statement:") + sqlite3_errmsg(m_database) + "\n\nWith statement\n" + getSource()); 
+			throwSQLiteError(rc, std::string("Could not execute statement:") + sqlite3_errmsg(m_database) + "\n\nWith statement\n" + getSource());
 		}
 
 		sqlite3_reset(m_stmt);
@@ -128,62 +479,325 @@ public:
 	void query(const std::vector<std::string>& args, DatabaseResult& result) override
 	{
 		if(!m_stmt) throw std::runtime_error("Statement was not built!");
+		BindingGuard guard(m_stmt);
 		for(size_t i = 0; i < args.size(); i++)
 		{
 			sqlite3_bind_text(m_stmt, i + 1, args[i].c_str(), args[i].size(), nullptr);
 		}
-		
-		size_t colnum = sqlite3_column_count(m_stmt);
-		int rc = 0;
-		while(true) // TODO  Maybe row limit?
+
+		readRows(result);
+	}
+
+	// Binds the arguments directly from the caller's memory
+	void queryRef(const ArgViews& args, DatabaseResult& result)
+	{
+		if(!m_stmt) throw std::runtime_error("Statement was not built!");
+		BindingGuard guard(m_stmt);
+		bind(args);
+		readRows(result);
+	}
+	
+	bool queryScalar(const std::vector<std::string>& args, std::string& value) override
+	{
+		if(!m_stmt) throw std::runtime_error("Statement was not built!");
+		BindingGuard guard(m_stmt);
+		for(size_t i = 0; i < args.size(); i++)
 		{
-			rc = sqlite3_step(m_stmt);
-			if(rc == SQLITE_ROW)
-			{
-				std::unordered_map<std::string, std::string> row;
-				for (size_t i = 0; i < colnum; i++)
-				{
-					auto name = sqlite3_column_name(m_stmt, i);
-					if(sqlite3_column_type(m_stmt, i) != SQLITE_NULL)
-						row[name] = reinterpret_cast<const char*>(sqlite3_column_text(m_stmt, i));
-					else
-						row[name] = "";
-				}
-				result.push_back(std::move(row));
-			}
-			else
+			sqlite3_bind_text(m_stmt, i + 1, args[i].c_str(), args[i].size(), nullptr);
+		}
+
+		bool found = false;
+		const int rc = sqlite3_step(m_stmt);
+		if(rc == SQLITE_ROW)
+		{
+			if(sqlite3_column_type(m_stmt, 0) != SQLITE_NULL)
 			{
-				break;
+				const char* text = reinterpret_cast<const char*>(sqlite3_column_text(m_stmt, 0));
+				value.assign(text, sqlite3_column_bytes(m_stmt, 0));
+				found = true;
 			}
-			
 		}
-
-		if(rc != SQLITE_DONE)
+		else if(rc != SQLITE_DONE)
 		{
 			sqlite3_reset(m_stmt);
-			throw std::runtime_error(std::string("Could not execute statement:") + sqlite3_errmsg(m_database) + "\n\nWith statement\n" + getSource()); 
+			throwSQLiteError(rc, std::string("Could not execute statement:") + sqlite3_errmsg(m_database) + "\n\nWith statement\n" + getSource());
 		}
 
 		sqlite3_reset(m_stmt);
+		return found;
 	}
-	
+
+	SQLiteStmtStatus getStatus(bool reset = false)
+	{
+		SQLiteStmtStatus status;
+		if(!m_stmt) return status;
+
+		status.fullscanSteps = sqlite3_stmt_status(m_stmt, SQLITE_STMTSTATUS_FULLSCAN_STEP, reset);
+		status.sorts = sqlite3_stmt_status(m_stmt, SQLITE_STMTSTATUS_SORT, reset);
+		status.autoindex = sqlite3_stmt_status(m_stmt, SQLITE_STMTSTATUS_AUTOINDEX, reset);
+		status.vmSteps = sqlite3_stmt_status(m_stmt, SQLITE_STMTSTATUS_VM_STEP, reset);
+#if SQLITE_VERSION_NUMBER >= 3020000
+		// Never reset, refreshColumns() compares it against the count of the last refresh
+		status.reprepares = sqlite3_stmt_status(m_stmt, SQLITE_STMTSTATUS_REPREPARE, 0);
+		status.runs = sqlite3_stmt_status(m_stmt, SQLITE_STMTSTATUS_RUN, reset);
+#endif
+		return status;
+	}
+
 	void build() override
 	{
 		if(m_stmt) throw std::runtime_error("Statement was already built!");
-		if(sqlite3_prepare_v2(m_database, getSource().c_str(), -1, &m_stmt, 0) != SQLITE_OK) 
+		const int rc = prepare(getSource().c_str(), nullptr);
+		if(rc != SQLITE_OK)
 		{ 
 			sqlite3_finalize(m_stmt);
 			m_stmt = nullptr;
 			throw std::runtime_error(std::string("Could not prepare statement:") + sqlite3_errmsg(m_database) + "\n\nWith statement\n" + getSource()); 
 		}
+
+		readColumns();
 	}
+
+	// Prepares the first statement of script and returns the remaining script. Nothing is prepared
+	// if the script starts with whitespace or comments only, see isEmpty().
+	const char* buildNext(const char* script)
+	{
+		if(m_stmt) throw std::runtime_error("Statement was already built!");
+		const char* tail = nullptr;
+		const int rc = prepare(script, &tail);
+		if(rc != SQLITE_OK)
+		{
+			sqlite3_finalize(m_stmt);
+			m_stmt = nullptr;
+			throwSQLiteError(rc, std::string("Could not access database: ") + sqlite3_errmsg(m_database));
+		}
+
+		setSource(std::string(script, tail - script));
+		if(m_stmt)
+			readColumns();
+		return tail;
+	}
+
+	bool isEmpty() const { return !m_stmt; }
 };
 	
-class SQLiteConnection : public DatabaseConnection
+// Handle for incremental I/O on a single blob value, which is read or written in place
+// without loading it as a whole. See sqlite3_blob_open.
+class SQLiteBlob
 {
-	std::unordered_map<std::string, std::shared_ptr<SQLiteStmt>> m_stmtCache;
+	sqlite3_blob* m_blob = nullptr;
 	sqlite3* m_database;
+
+	void check(int rc, const char* action)
+	{
+		if(rc != SQLITE_OK)
+			throwSQLiteError(rc, std::string("Could not ") + action + " blob: " + sqlite3_errmsg(m_database));
+	}
+
+public:
+	SQLiteBlob(sqlite3* db, const std::string& table, const std::string& column, unsigned long long rowid, bool writable):
+		m_database(db)
+	{
+		const int rc = sqlite3_blob_open(db, "main", table.c_str(), column.c_str(), rowid, writable, &m_blob);
+		if(rc != SQLITE_OK)
+		{
+			// The handle has to be closed even if opening failed
+			sqlite3_blob_close(m_blob);
+			m_blob = nullptr;
+			check(rc, "open");
+		}
+	}
+
+	~SQLiteBlob() { sqlite3_blob_close(m_blob); }
+
+	SQLiteBlob(const SQLiteBlob&) = delete;
+	SQLiteBlob& operator=(const SQLiteBlob&) = delete;
+
+	size_t size() const { return sqlite3_blob_bytes(m_blob); }
+
+	void read(void* buffer, size_t size, size_t offset) { check(sqlite3_blob_read(m_blob, buffer, size, offset), "read"); }
+	void write(const void* data, size_t size, size_t offset) { check(sqlite3_blob_write(m_blob, data, size, offset), "write"); }
+
+	// Moves the handle to the same column of another row, which is faster than opening a new one.
+	void reopen(unsigned long long rowid) { check(sqlite3_blob_reopen(m_blob, rowid), "reopen"); }
+};
+
+// Prepared statements by SQL text. Holds at most capacity entries and evicts the least recently used one first.
+template<typename V>
+class SourceCache
+{
+	struct Entry
+	{
+		V value;
+		std::list<std::string>::iterator position;
+	};
+
+	std::unordered_map<std::string, Entry> m_entries;
+	std::list<std::string> m_order; // Most recently used first
+	size_t m_capacity;
+
+	void trim(size_t size)
+	{
+		while(m_entries.size() > size)
+		{
+			m_entries.erase(m_order.back());
+			m_order.pop_back();
+		}
+	}
+
+public:
+	SourceCache(size_t capacity): m_capacity(capacity) {}
+
+	V* find(const std::string& source)
+	{
+		auto iter = m_entries.find(source);
+		if(iter == m_entries.end())
+			return nullptr;
+
+		m_order.splice(m_order.begin(), m_order, iter->second.position);
+		return &iter->second.value;
+	}
+
+	// source must not be cached yet
+	void put(const std::string& source, V value)
+	{
+		if(!m_capacity)
+			return;
+
+		trim(m_capacity - 1);
+		m_order.push_front(source);
+		m_entries.emplace(source, Entry{std::move(value), m_order.begin()});
+	}
+
+	// 0 disables caching
+	void setCapacity(size_t capacity)
+	{
+		m_capacity = capacity;
+		trim(capacity);
+	}
+
+	void clear()
+	{
+		m_entries.clear();
+		m_order.clear();
+	}
+
+	size_t size() const { return m_entries.size(); }
+
+	template<typename Fn>
+	void forEach(Fn&& fn)
+	{
+		for(auto& entry : m_entries)
+			fn(entry.first, entry.second.value);
+	}
+};
+
+class SQLiteConnection : public DatabaseConnection
+{
+	SourceCache<std::shared_ptr<SQLiteStmt>> m_stmtCache{1024};
+
+	// Statement sequences of query(string) by script
+	SourceCache<std::vector<std::shared_ptr<SQLiteStmt>>> m_scriptCache{64};
+
+	// Set by persistent() for the statement of the next query call
+	bool m_persistNext = false;
+
+	bool takePersistent()
+	{
+		const bool persist = m_persistNext;
+		m_persistNext = false;
+		return persist;
+	}
+
+	sqlite3* m_database = nullptr;
 	std::string m_databaseName;
+	SQLiteProfile m_profile = getSQLiteProfile(PROFILE_DEFAULT);
+	SQLITE_THREADING m_threading = THREADING_DEFAULT;
+	std::chrono::milliseconds m_busyTimeout{1000};
+	std::function<void(int)> m_walHook;
+
+	static int walHook(void* data, sqlite3*, const char*, int frames)
+	{
+		static_cast<SQLiteConnection*>(data)->m_walHook(frames);
+		return SQLITE_OK;
+	}
+
+	// Some pragmas return no row, e.g. mmap_size for in-memory databases
+	std::string pragma(const char* name)
+	{
+		std::string value = "0";
+		queryScalar(std::string("PRAGMA ") + name + ";", {}, value);
+		return value;
+	}
+
+	int dbStatus(int op)
+	{
+		int current = 0, highwater = 0;
+		sqlite3_db_status(m_database, op, &current, &highwater, 0);
+		return current;
+	}
+
+	// Copies the main database of from into to. Between steps of pagesPerStep pages (-1 copies everything
+	// at once) the locks are released for pause, so other connections can keep working. If they write
+	// in between, the copy starts over, writes through this connection are applied to the copy directly.
+	// Fails with BusyError once the databases stay locked for longer than busyTimeout without progress.
+	static BackupStats copyDatabase(sqlite3* to, sqlite3* from, int pagesPerStep, std::chrono::milliseconds pause,
+					std::chrono::milliseconds busyTimeout)
+	{
+		const auto start = std::chrono::steady_clock::now();
+
+		sqlite3_backup* backup = sqlite3_backup_init(to, "main", from, "main");
+		if(!backup)
+			throw std::runtime_error(std::string("Could not start backup: ") + sqlite3_errmsg(to));
+
+		BackupStats stats;
+		int rc = SQLITE_OK;
+		auto progress = std::chrono::steady_clock::now();
+		while(true)
+		{
+			rc = sqlite3_backup_step(backup, pagesPerStep);
+			stats.steps++;
+
+			if(rc == SQLITE_BUSY || rc == SQLITE_LOCKED)
+			{
+				stats.busy++;
+				if(std::chrono::steady_clock::now() - progress >= busyTimeout)
+					break;
+
+				std::this_thread::sleep_for(std::max(pause, std::chrono::milliseconds(1)));
+			}
+			else if(rc == SQLITE_OK)
+			{
+				progress = std::chrono::steady_clock::now();
+				if(pause.count())
+					std::this_thread::sleep_for(pause);
+			}
+			else
+			{
+				break;
+			}
+		}
+
+		stats.pages = sqlite3_backup_pagecount(backup);
+		sqlite3_backup_finish(backup);
+		stats.duration = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+
+		if(rc != SQLITE_DONE)
+			throwSQLiteError(rc, std::string("Could not copy database: ") + sqlite3_errmsg(to));
+
+		return stats;
+	}
+
+	// Takes the argument types of the aggregate from its step method
+	template<typename A, typename R, typename... Args>
+	void createAggregate(const std::string& name, R (A::*)(Args...))
+	{
+		const int rc = sqlite3_create_function_v2(m_database, name.c_str(), sizeof...(Args), SQLITE_UTF8, nullptr,
+			nullptr, &AggregateFunction<A, Args...>::step, &AggregateFunction<A, Args...>::final, nullptr);
+
+		if(rc != SQLITE_OK)
+			throwSQLiteError(rc, "Could not register aggregate " + name + ": " + sqlite3_errmsg(m_database));
+	}
 
 public:
 	~SQLiteConnection() { close(); }
@@ -191,32 +805,200 @@ public:
 	void connect(const std::string& db, const std::string&, const std::string&,
 			       const std::string&, const std::string&, const unsigned short) override
 	{
-		//sqlite3_shutdown();
-		//if(sqlite3_config(SQLITE_CONFIG_SERIALIZED) != SQLITE_OK)
-		//throw std::runtime_error(std::string("Could not configure thread safety: ") +
-		//			      sqlite3_errmsg(m_database));
-		
-		//   sqlite3_initialize();
 		if(db != ":memory:")
 			m_databaseName = db + ".db";
 		else
 			m_databaseName = ":memory:";
-			
-		if (sqlite3_open(m_databaseName.c_str(), &m_database))
-			throw std::runtime_error(std::string("Could not open database: ") +
-					sqlite3_errmsg(m_database));
+
+		int flags = SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE;
+		if(m_threading == THREADING_MULTI || m_threading == THREADING_SINGLE)
+			flags |= SQLITE_OPEN_NOMUTEX;
+		else if(m_threading == THREADING_SERIALIZED)
+			flags |= SQLITE_OPEN_FULLMUTEX;
+
+		if (sqlite3_open_v2(m_databaseName.c_str(), &m_database, flags, nullptr))
+		{
+			const std::string msg = std::string("Could not open database: ") + sqlite3_errmsg(m_database);
+			sqlite3_close(m_database);
+			m_database = nullptr;
+			throw std::runtime_error(msg);
+		}
 		
-		if(sqlite3_threadsafe() == 0)
+		if(sqlite3_threadsafe() == 0 && m_threading != THREADING_SINGLE)
 			std::cerr << "SQlite is not compiled as thread safe!" << std::endl;
 
-		sqlite3_busy_timeout(m_database, 1000);
-		query("PRAGMA journal_mode=WAL");
+		sqlite3_busy_timeout(m_database, m_busyTimeout.count());
+
+		// The page size can not be changed anymore once the database uses WAL
+		if(m_profile.pageSize)
+			exec("PRAGMA page_size=" + std::to_string(m_profile.pageSize));
+
+		exec("PRAGMA journal_mode=WAL");
+		applyProfile(m_profile);
 	}
 	
 	void connect(const std::string& db)
 	{
 		connect(db, "", "", "", "", 0);
 	}
+
+	void connect(const std::string& db, SQLITE_PROFILE profile)
+	{
+		setProfile(getSQLiteProfile(profile));
+		connect(db, "", "", "", "", 0);
+	}
+
+	// Sets the threading mode of the next connect. THREADING_SINGLE additionally needs configureThreading.
+	void setThreading(SQLITE_THREADING threading) { m_threading = threading; }
+
+	// Sets the threading mode of the whole process, which is only possible before SQLite is initialized,
+	// i.e. before the first connection is opened. THREADING_SINGLE removes all of SQLite's mutexes, so it
+	// must not be combined with anything using SQLite from another thread, e.g. WALCheckpointer.
+	static void configureThreading(SQLITE_THREADING threading)
+	{
+		int rc = SQLITE_OK;
+		switch(threading)
+		{
+			case THREADING_SINGLE: rc = sqlite3_config(SQLITE_CONFIG_SINGLETHREAD); break;
+			case THREADING_MULTI: rc = sqlite3_config(SQLITE_CONFIG_MULTITHREAD); break;
+			case THREADING_SERIALIZED: rc = sqlite3_config(SQLITE_CONFIG_SERIALIZED); break;
+			default: break;
+		}
+
+		if(rc != SQLITE_OK)
+			throw std::runtime_error(std::string("Could not configure thread safety: ") + sqlite3_errstr(rc));
+	}
+
+	// False if the connection does without a mutex, e.g. opened with THREADING_MULTI.
+	bool isSerialized() const { return m_database && sqlite3_db_mutex(m_database); }
+
+	// Sets the profile applied by the next connect.
+	void setProfile(const SQLiteProfile& profile) { m_profile = profile; }
+
+	// Applies a profile to the open connection. The page size is ignored by SQLite unless the database is still empty.
+	void applyProfile(const SQLiteProfile& profile)
+	{
+		if(profile.pageSize)
+			exec("PRAGMA page_size=" + std::to_string(profile.pageSize));
+		if(profile.synchronous)
+			exec(std::string("PRAGMA synchronous=") + profile.synchronous);
+		if(profile.mmapSize)
+			exec("PRAGMA mmap_size=" + std::to_string(profile.mmapSize < 0 ? 0 : profile.mmapSize));
+		if(profile.cacheSize)
+			exec("PRAGMA cache_size=" + std::to_string(profile.cacheSize));
+		if(profile.tempStore)
+			exec(std::string("PRAGMA temp_store=") + profile.tempStore);
+		if(profile.walAutocheckpoint)
+			exec("PRAGMA wal_autocheckpoint=" + std::to_string(profile.walAutocheckpoint));
+	}
+
+	// Reads the settings back from SQLite, which silently ignores values it can not apply.
+	SQLiteStatus getStatus()
+	{
+		SQLiteStatus status;
+		status.journalMode = pragma("journal_mode");
+		status.synchronous = std::stoi(pragma("synchronous"));
+		status.mmapSize = std::stoll(pragma("mmap_size"));
+		status.cacheSize = std::stoll(pragma("cache_size"));
+		status.tempStore = std::stoi(pragma("temp_store"));
+		status.walAutocheckpoint = std::stoi(pragma("wal_autocheckpoint"));
+		status.pageSize = std::stoi(pragma("page_size"));
+
+		status.cacheUsed = dbStatus(SQLITE_DBSTATUS_CACHE_USED);
+		status.cacheHit = dbStatus(SQLITE_DBSTATUS_CACHE_HIT);
+		status.cacheMiss = dbStatus(SQLITE_DBSTATUS_CACHE_MISS);
+		status.cacheWrite = dbStatus(SQLITE_DBSTATUS_CACHE_WRITE);
+		status.schemaUsed = dbStatus(SQLITE_DBSTATUS_SCHEMA_USED);
+		status.stmtUsed = dbStatus(SQLITE_DBSTATUS_STMT_USED);
+		return status;
+	}
+
+	// How long SQLite waits for a lock before a statement fails with BusyError.
+	void setBusyTimeout(int milliseconds)
+	{
+		m_busyTimeout = std::chrono::milliseconds(milliseconds);
+		sqlite3_busy_timeout(m_database, milliseconds);
+	}
+
+	// WAL size in pages after which a commit runs a checkpoint, 0 disables automatic checkpoints.
+	void setAutoCheckpoint(int pages)
+	{
+		// Automatic checkpoints are a WAL hook as well and replace the one set before
+		m_walHook = nullptr;
+		if(m_database)
+			sqlite3_wal_autocheckpoint(m_database, pages);
+	}
+
+	// Called after every commit through this connection with the number of frames in the WAL.
+	// Replaces automatic checkpoints until setAutoCheckpoint() is called again.
+	void setWalHook(std::function<void(int frames)> hook)
+	{
+		m_walHook = std::move(hook);
+		if(m_database)
+			sqlite3_wal_hook(m_database, m_walHook ? &SQLiteConnection::walHook : nullptr, this);
+	}
+
+	int getAutoCheckpoint()
+	{
+		return std::stoi(pragma("wal_autocheckpoint"));
+	}
+
+	// Writes a consistent snapshot of the database to the file at path (no ".db" is appended) while
+	// the connection stays usable. See copyDatabase for the meaning of pagesPerStep and pause.
+	BackupStats backup(const std::string& path, int pagesPerStep = 100, std::chrono::milliseconds pause = std::chrono::milliseconds(0))
+	{
+		sqlite3* target = nullptr;
+		if(sqlite3_open(path.c_str(), &target) != SQLITE_OK)
+		{
+			const std::string msg = std::string("Could not open backup file: ") + sqlite3_errmsg(target);
+			sqlite3_close(target);
+			throw std::runtime_error(msg);
+		}
+
+		try
+		{
+			const BackupStats stats = copyDatabase(target, m_database, pagesPerStep, pause, m_busyTimeout);
+			sqlite3_close(target);
+			return stats;
+		}
+		catch(...)
+		{
+			sqlite3_close(target);
+			throw;
+		}
+	}
+
+	// Replaces the content of this connection's database with the database file at path, e.g. to
+	// serve a read-mostly database from ":memory:". Cached statements are prepared again on next use.
+	BackupStats load(const std::string& path)
+	{
+		sqlite3* source = nullptr;
+		if(sqlite3_open_v2(path.c_str(), &source, SQLITE_OPEN_READONLY, nullptr) != SQLITE_OK)
+		{
+			const std::string msg = std::string("Could not open database to load: ") + sqlite3_errmsg(source);
+			sqlite3_close(source);
+			throw std::runtime_error(msg);
+		}
+
+		// Cached statements were prepared against the schema which is about to be replaced
+		m_scriptCache.clear();
+		m_stmtCache.clear();
+
+		try
+		{
+			const BackupStats stats = copyDatabase(m_database, source, -1, std::chrono::milliseconds(0), m_busyTimeout);
+			sqlite3_close(source);
+			return stats;
+		}
+		catch(...)
+		{
+			sqlite3_close(source);
+			throw;
+		}
+	}
+
+	// Path of the database file or ":memory:"
+	const std::string& getFileName() const { return m_databaseName; }
 	
 	std::shared_ptr<PreparedStmt> getStatement(const std::string& source) override
 	{
@@ -225,43 +1007,197 @@ public:
 		return stmt;
 	}
 	
-	std::shared_ptr<PreparedStmt> getCachedStmt(const std::string& source)
+	// Persistent statements are kept out of SQLite's lookaside memory, which is meant for
+	// short lived statements. Only statements which are run over and over should be persistent.
+	std::shared_ptr<PreparedStmt> getCachedStmt(const std::string& source, bool persistent = false)
+	{
+		return getSQLiteStmt(source, persistent);
+	}
+
+	std::shared_ptr<SQLiteStmt> getSQLiteStmt(const std::string& source, bool persistent = false)
+	{
+		if(auto cached = m_stmtCache.find(source))
+			return *cached;
+
+		auto stmt = std::make_shared<SQLiteStmt>(m_database, persistent ? PREPARE_PERSISTENT : 0);
+		stmt->buildSource(source);
+
+		m_stmtCache.put(source, stmt);
+		return stmt;
+	}
+
+	DatabaseConnection& persistent() override
+	{
+		m_persistNext = true;
+		return *this;
+	}
+
+	// Number of statements with arguments which are kept prepared, 0 disables caching them.
+	void setStatementCacheSize(size_t statements) { m_stmtCache.setCapacity(statements); }
+
+	// Counters of all cached statements by source, e.g. to find statements which scan whole tables.
+	std::unordered_map<std::string, SQLiteStmtStatus> getStatementStatus(bool reset = false)
 	{
-		auto stmtIter = m_stmtCache.find(source);
-		if(stmtIter == m_stmtCache.end())
+		std::unordered_map<std::string, SQLiteStmtStatus> result;
+		m_stmtCache.forEach([&](const std::string& source, std::shared_ptr<SQLiteStmt>& stmt)
 		{
-			auto stmt = std::make_shared<SQLiteStmt>(m_database);
-			stmt->buildSource(source);
-			
-			m_stmtCache[source] = stmt;
-			return stmt;
-		}
-		
-		return stmtIter->second;
+			result[source] = stmt->getStatus(reset);
+		});
+
+		m_scriptCache.forEach([&](const std::string&, std::vector<std::shared_ptr<SQLiteStmt>>& statements)
+		{
+			for(auto& stmt : statements)
+				result[stmt->getSource()] = stmt->getStatus(reset);
+		});
+		return result;
 	}
-	
+
 	std::string queryJson(const std::string& query, const std::vector<std::string>& args) override
 	{
-		return getCachedStmt(query)->queryJson(args);
+		return getCachedStmt(query, takePersistent())->queryJson(args);
 	}
 
 	std::string queryJson(const std::string & query) override
 	{
-		return getCachedStmt(query)->queryJson();
+		return getCachedStmt(query, takePersistent())->queryJson();
+	}
+
+	bool queryScalar(const std::string& query, const std::vector<std::string>& args, std::string& value) override
+	{
+		return getCachedStmt(query, takePersistent())->queryScalar(args, value);
 	}
 	
+	// Runs one or more statements without arguments. The statements of the last scripts are kept
+	// prepared, so repeated calls (e.g. begin/commit) do not parse the SQL again.
 	void query(const std::string& q) override
+	{
+		const unsigned int flags = takePersistent() ? PREPARE_PERSISTENT : 0;
+		if(auto cached = m_scriptCache.find(q))
+		{
+			for(auto& stmt : *cached)
+				stmt->query();
+			return;
+		}
+
+		// Statements are split off one at a time and run right away since later statements
+		// might depend on earlier ones, e.g. an insert into a table created before.
+		std::vector<std::shared_ptr<SQLiteStmt>> sequence;
+		const char* tail = q.c_str();
+		while(*tail)
+		{
+			auto stmt = std::make_shared<SQLiteStmt>(m_database, flags);
+			tail = stmt->buildNext(tail);
+
+			// Whitespace and comments do not produce a statement
+			if(stmt->isEmpty())
+				continue;
+
+			stmt->query();
+			sequence.push_back(std::move(stmt));
+		}
+
+		m_scriptCache.put(q, std::move(sequence));
+	}
+
+	// Number of scripts query(string) keeps prepared, 0 disables caching them.
+	void setScriptCacheSize(size_t scripts) { m_scriptCache.setCapacity(scripts); }
+
+	// Runs SQL without caching it, e.g. for scripts which are only executed once.
+	void exec(const std::string& q)
 	{
 		char* error = nullptr;
-		if(sqlite3_exec(m_database, q.c_str(), nullptr, nullptr, &error) != SQLITE_OK)
-			throw std::runtime_error(std::string("Could not access database: ") + error);
+		const int rc = sqlite3_exec(m_database, q.c_str(), nullptr, nullptr, &error);
+		if(rc != SQLITE_OK)
+		{
+			const std::string msg = std::string("Could not access database: ") + (error ? error : sqlite3_errstr(rc));
+			sqlite3_free(error);
+			throwSQLiteError(rc, msg);
+		}
 	}
 	
 	void query(const std::string& query, const std::vector<std::string>& args, DatabaseResult& result) override
 	{
-		getCachedStmt(query)->query(args, result);
+		getCachedStmt(query, takePersistent())->query(args, result);
+	}
+
+	void queryRef(const std::string& query, const ArgViews& args, DatabaseResult& result) override
+	{
+		getSQLiteStmt(query, takePersistent())->queryRef(args, result);
 	}
+	using DatabaseConnection::queryRef;
 	
+	// Registers a C++ function which SQL on this connection can call, e.g. in scripts or predicates.
+	// Arguments and results may be integers, floating point numbers, std::string, Blob and std::optional
+	// for NULL results. Exceptions are reported as SQL errors. Deterministic functions can be used in
+	// indexes and are evaluated only once per statement for constant arguments.
+	template<typename R, typename... Args>
+	void createFunction(const std::string& name, std::function<R(Args...)> function, bool deterministic = true)
+	{
+		// SQLite calls destroy once the function is replaced, the connection closed or registering failed
+		auto data = new ScalarFunction<R, Args...>{std::move(function)};
+		const int rc = sqlite3_create_function_v2(m_database, name.c_str(), sizeof...(Args),
+			SQLITE_UTF8 | (deterministic ? SQLITE_DETERMINISTIC : 0), data,
+			&ScalarFunction<R, Args...>::call, nullptr, nullptr, &ScalarFunction<R, Args...>::destroy);
+
+		if(rc != SQLITE_OK)
+			throwSQLiteError(rc, "Could not register function " + name + ": " + sqlite3_errmsg(m_database));
+	}
+
+	template<typename R, typename... Args>
+	void createFunction(const std::string& name, R (*function)(Args...), bool deterministic = true)
+	{
+		createFunction(name, std::function<R(Args...)>(function), deterministic);
+	}
+
+	// Registers an aggregate implemented by the default constructible class A, which has a
+	// step(<args>) method called for every row and a finish() method returning the result.
+	template<typename A>
+	void createAggregate(const std::string& name)
+	{
+		createAggregate<A>(name, &A::step);
+	}
+
+	// Opens a blob of the main database for incremental I/O. Writes can not change its size,
+	// which is set beforehand, e.g. with zeroblob().
+	std::unique_ptr<SQLiteBlob> openBlob(const std::string& table, const std::string& column, unsigned long long id, bool writable = false)
+	{
+		return std::unique_ptr<SQLiteBlob>(new SQLiteBlob(m_database, table, column, id, writable));
+	}
+
+	size_t readBlob(const std::string& table, const std::string& column, unsigned long long id,
+			std::ostream& out, size_t chunkSize = 1 << 20) override
+	{
+		auto blob = openBlob(table, column, id);
+		const size_t size = blob->size();
+		std::vector<char> chunk(std::max<size_t>(1, std::min(chunkSize, size)));
+
+		for(size_t offset = 0; offset < size; offset += chunk.size())
+		{
+			const size_t count = std::min(chunk.size(), size - offset);
+			blob->read(chunk.data(), count, offset);
+			out.write(chunk.data(), count);
+		}
+		return size;
+	}
+
+	// Allocates the blob with zeroblob() and fills it in place, so it is never held in memory as a whole.
+	void writeBlob(const std::string& table, const std::string& column, unsigned long long id,
+			std::istream& in, size_t size, size_t chunkSize = 1 << 20) override
+	{
+		queryRef("update `" + table + "` set `" + column + "` = zeroblob(?) where id = ?;", {size, id});
+
+		auto blob = openBlob(table, column, id, true);
+		std::vector<char> chunk(std::max<size_t>(1, std::min(chunkSize, size)));
+		for(size_t offset = 0; offset < size; offset += chunk.size())
+		{
+			const size_t count = std::min(chunk.size(), size - offset);
+			if(!in.read(chunk.data(), count))
+				throw std::runtime_error("Could not read blob data for " + table + "." + column + "!");
+
+			blob->write(chunk.data(), count, offset);
+		}
+	}
+
 	void execute(const std::string & file) override
 	{
 		std::ifstream in(file);
@@ -271,11 +1207,12 @@ public:
 		std::stringstream buf;
 		buf << in.rdbuf();
 
-		query(buf.str());
+		exec(buf.str());
 	}
 	
 	void close() override
 	{
+		m_scriptCache.clear();
 		m_stmtCache.clear();
 		sqlite3_close(m_database); 
 		m_database = nullptr;
@@ -290,6 +1227,9 @@ public:
 	
 	const char* getName() const override { return "SQLite"; }
 	DBTYPE getType() const override { return SQLITE; }
+
+	// Stay well below SQLITE_MAX_VARIABLE_NUMBER which defaults to 999 on older versions
+	size_t getBatchSize() const override { return 500; }
 };
 
 }
@@ -0,0 +1,266 @@
+#ifndef LUASQLGEN_TABLEEXPORT_H
+#define LUASQLGEN_TABLEEXPORT_H
+
+#include "DatabaseConnection.h"
+#include <string_view>
+#include <cstring>
+#include <cerrno>
+#include <cstdint>
+
+#ifdef WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+namespace luasqlgen
+{
+
+enum EXPORT_FORMAT
+{
+	EXPORT_CSV = 0,
+	EXPORT_NDJSON,
+	EXPORT_BINARY
+};
+
+struct ExportColumn
+{
+	const char* name;
+	bool text; // Text columns are quoted in NDJSON output
+	bool blob = false; // Blobs are written as hex in CSV and NDJSON output, which can not hold binary data
+};
+
+// Collects output in a large buffer and writes it to a file descriptor in big chunks.
+class FdWriter
+{
+	int m_fd;
+	std::vector<char> m_buffer;
+	size_t m_used = 0;
+
+	void writeAll(const char* data, size_t size)
+	{
+		size_t written = 0;
+		while(written < size)
+		{
+			const auto rc = ::write(m_fd, data + written, size - written);
+			if(rc < 0)
+			{
+				if(errno == EINTR) continue;
+				throw std::runtime_error(std::string("Could not write export: ") + strerror(errno));
+			}
+			written += rc;
+		}
+	}
+
+public:
+	FdWriter(int fd, size_t bufferSize = 1 << 20):
+		m_fd(fd), m_buffer(bufferSize) {}
+
+	~FdWriter()
+	{
+		try
+		{
+			flush();
+		}
+		catch(...) {}
+	}
+
+	void flush()
+	{
+		writeAll(m_buffer.data(), m_used);
+		m_used = 0;
+	}
+
+	void write(const char* data, size_t size)
+	{
+		if(m_used + size > m_buffer.size())
+		{
+			flush();
+
+			// Too big to be buffered, write directly
+			if(size > m_buffer.size())
+			{
+				writeAll(data, size);
+				return;
+			}
+		}
+
+		memcpy(m_buffer.data() + m_used, data, size);
+		m_used += size;
+	}
+
+	void write(std::string_view data) { write(data.data(), data.size()); }
+
+	void put(char c)
+	{
+		if(m_used == m_buffer.size())
+			flush();
+		m_buffer[m_used++] = c;
+	}
+};
+
+/**
+ * Writes database rows to a file descriptor as CSV (RFC 4180, header line first),
+ * newline delimited JSON (one object per line) or a binary format. Blob columns are
+ * lower case hex in CSV and JSON, and their raw bytes in the binary format.
+ *
+ * The binary format starts with "LSQL", the column count and the column names. Every row
+ * follows as its column values in the same order. Counts and string lengths are
+ * 32 bit unsigned integers in host byte order, each string is followed by its bytes.
+ */
+class TableExporter
+{
+	FdWriter m_out;
+	EXPORT_FORMAT m_format;
+	const ExportColumn* m_columns;
+	size_t m_count;
+
+	void writeLength(size_t length)
+	{
+		const uint32_t value = length;
+		m_out.write(reinterpret_cast<const char*>(&value), sizeof(value));
+	}
+
+	void writeCSV(std::string_view value)
+	{
+		if(value.find_first_of(",\"\r\n") == std::string_view::npos)
+		{
+			m_out.write(value);
+			return;
+		}
+
+		m_out.put('"');
+		for(char c : value)
+		{
+			if(c == '"') m_out.put('"');
+			m_out.put(c);
+		}
+		m_out.put('"');
+	}
+
+	void writeHex(std::string_view value)
+	{
+		static const char* hex = "0123456789abcdef";
+		for(char c : value)
+		{
+			m_out.put(hex[(c >> 4) & 0xf]);
+			m_out.put(hex[c & 0xf]);
+		}
+	}
+
+	void writeJsonString(std::string_view value)
+	{
+		static const char* hex = "0123456789abcdef";
+		m_out.put('"');
+		for(char c : value)
+		{
+			switch(c)
+			{
+				case '"': m_out.write("\\\"", 2); break;
+				case '\\': m_out.write("\\\\", 2); break;
+				case '\n': m_out.write("\\n", 2); break;
+				case '\r': m_out.write("\\r", 2); break;
+				case '\t': m_out.write("\\t", 2); break;
+				default:
+					if(static_cast<unsigned char>(c) < 0x20)
+					{
+						const char escaped[] = {'\\', 'u', '0', '0', hex[(c >> 4) & 0xf], hex[c & 0xf]};
+						m_out.write(escaped, sizeof(escaped));
+					}
+					else
+					{
+						m_out.put(c);
+					}
+			}
+		}
+		m_out.put('"');
+	}
+
+public:
+	TableExporter(int fd, EXPORT_FORMAT format, const ExportColumn* columns, size_t count):
+		m_out(fd), m_format(format), m_columns(columns), m_count(count) {}
+
+	void writeHeader()
+	{
+		switch(m_format)
+		{
+			case EXPORT_CSV:
+				for(size_t i = 0; i < m_count; i++)
+				{
+					if(i) m_out.put(',');
+					writeCSV(m_columns[i].name);
+				}
+				m_out.write("\r\n", 2);
+			break;
+
+			case EXPORT_BINARY:
+				m_out.write("LSQL", 4);
+				writeLength(m_count);
+				for(size_t i = 0; i < m_count; i++)
+				{
+					const size_t length = strlen(m_columns[i].name);
+					writeLength(length);
+					m_out.write(m_columns[i].name, length);
+				}
+			break;
+
+			case EXPORT_NDJSON: break;
+		}
+	}
+
+	void writeRow(const ResultLine& row)
+	{
+		static const std::string empty;
+		if(m_format == EXPORT_NDJSON)
+			m_out.put('{');
+
+		for(size_t i = 0; i < m_count; i++)
+		{
+			auto iter = row.find(m_columns[i].name);
+			const std::string& value = iter != row.end() ? iter->second : empty;
+
+			switch(m_format)
+			{
+				case EXPORT_CSV:
+					if(i) m_out.put(',');
+					if(m_columns[i].blob)
+						writeHex(value);
+					else
+						writeCSV(value);
+				break;
+
+				case EXPORT_NDJSON:
+					if(i) m_out.put(',');
+					writeJsonString(m_columns[i].name);
+					m_out.put(':');
+					if(m_columns[i].blob)
+					{
+						m_out.put('"');
+						writeHex(value);
+						m_out.put('"');
+					}
+					else if(m_columns[i].text || value.empty())
+						writeJsonString(value);
+					else
+						m_out.write(value);
+				break;
+
+				case EXPORT_BINARY:
+					writeLength(value.size());
+					m_out.write(value);
+				break;
+			}
+		}
+
+		if(m_format == EXPORT_CSV)
+			m_out.write("\r\n", 2);
+		else if(m_format == EXPORT_NDJSON)
+			m_out.write("}\n", 2);
+	}
+
+	void finish() { m_out.flush(); }
+};
+
+}
+
+#endif
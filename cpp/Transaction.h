@@ -0,0 +1,188 @@
+#ifndef LUASQLGEN_TRANSACTION_H
+#define LUASQLGEN_TRANSACTION_H
+
+#include "DatabaseConnection.h"
+#include <chrono>
+#include <random>
+#include <thread>
+#include <algorithm>
+
+namespace luasqlgen
+{
+
+// Locking behaviour of the outermost transaction. Only SQLite distinguishes between these,
+// other backends always start a regular transaction.
+enum TRANSACTION_MODE
+{
+	DEFERRED = 0,
+	IMMEDIATE,
+	EXCLUSIVE
+};
+
+/**
+ * Scoped transaction.
+ *
+ * The outermost scope on a connection issues begin/commit, nested scopes are mapped to savepoints.
+ * A scope which is left without calling commit() (e.g. because of an exception) is rolled back.
+ */
+class Transaction
+{
+	DatabaseConnection& m_connection;
+	std::string m_savepoint;
+	bool m_open = true;
+
+	void finish()
+	{
+		m_open = false;
+		m_connection.m_transactionDepth--;
+	}
+
+public:
+	Transaction(DatabaseConnection& connection, TRANSACTION_MODE mode = DEFERRED):
+		m_connection(connection)
+	{
+		const unsigned int depth = m_connection.m_transactionDepth;
+		if(depth > 0)
+		{
+			m_savepoint = "luasqlgen_sp" + std::to_string(depth);
+			m_connection.query("savepoint " + m_savepoint + ";");
+		}
+		else if(m_connection.getType() == SQLITE)
+		{
+			static const char* begin[] = {"begin deferred;", "begin immediate;", "begin exclusive;"};
+			m_connection.persistent().query(begin[mode]);
+		}
+		else
+		{
+			m_connection.persistent().query("begin;");
+		}
+
+		m_connection.m_transactionDepth++;
+	}
+
+	Transaction(const Transaction&) = delete;
+	Transaction& operator=(const Transaction&) = delete;
+
+	~Transaction()
+	{
+		if(!m_open)
+			return;
+
+		try
+		{
+			rollback();
+		}
+		catch(...)
+		{
+			// The database might have already rolled back on its own, nothing left to do.
+			if(m_open)
+				finish();
+		}
+	}
+
+	void commit()
+	{
+		if(!m_open) throw std::runtime_error("Transaction was already finished!");
+
+		if(m_savepoint.empty())
+			m_connection.persistent().query("commit;");
+		else
+			m_connection.query("release savepoint " + m_savepoint + ";");
+
+		finish();
+	}
+
+	void rollback()
+	{
+		if(!m_open) throw std::runtime_error("Transaction was already finished!");
+
+		if(m_savepoint.empty())
+		{
+			m_connection.persistent().query("rollback;");
+		}
+		else
+		{
+			// Rolling back to a savepoint keeps it on the stack, so it needs to be released as well.
+			m_connection.query("rollback to savepoint " + m_savepoint + ";");
+			m_connection.query("release savepoint " + m_savepoint + ";");
+		}
+
+		finish();
+	}
+
+	bool isNested() const { return !m_savepoint.empty(); }
+};
+
+struct TransactionStats
+{
+	unsigned long long commits = 0;
+	unsigned long long retries = 0;
+	unsigned long long failures = 0;
+
+	// Time spent in attempts which failed because of contention, including backoff.
+	std::chrono::microseconds contentionTime{0};
+};
+
+/**
+ * Runs a function inside of a transaction and restarts it when the database reports
+ * lock contention (BusyError). Between attempts it sleeps for a random duration up to
+ * an exponentially growing limit ("full jitter") so competing writers spread out.
+ *
+ * Nested calls (i.e. inside of an already open transaction) are not retried since only
+ * the outermost transaction can release the locks the conflict is about.
+ */
+class TransactionRetry
+{
+	std::mt19937 m_random{std::random_device()()};
+	TransactionStats m_stats;
+
+	std::chrono::microseconds backoff(unsigned int attempt)
+	{
+		const std::chrono::microseconds limit = std::min(maxDelay, baseDelay * (1 << std::min(attempt, 20u)));
+		std::uniform_int_distribution<long long> dist(0, limit.count());
+		return std::chrono::microseconds(dist(m_random));
+	}
+
+public:
+	unsigned int maxAttempts = 8;
+	std::chrono::microseconds baseDelay{500};
+	std::chrono::microseconds maxDelay{100000};
+
+	template<typename Fn>
+	void run(DatabaseConnection& connection, Fn&& fn, TRANSACTION_MODE mode = IMMEDIATE)
+	{
+		const bool nested = connection.getTransactionDepth() > 0;
+		for(unsigned int attempt = 0;; attempt++)
+		{
+			const auto start = std::chrono::steady_clock::now();
+			try
+			{
+				Transaction transaction(connection, mode);
+				fn();
+				transaction.commit();
+				m_stats.commits++;
+				return;
+			}
+			catch(const BusyError&)
+			{
+				if(nested || attempt + 1 >= maxAttempts)
+				{
+					m_stats.failures++;
+					m_stats.contentionTime += std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+					throw;
+				}
+
+				std::this_thread::sleep_for(backoff(attempt));
+				m_stats.retries++;
+				m_stats.contentionTime += std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+			}
+		}
+	}
+
+	const TransactionStats& getStats() const { return m_stats; }
+	void resetStats() { m_stats = TransactionStats(); }
+};
+
+}
+
+#endif
@@ -0,0 +1,248 @@
+#ifndef LUASQLGEN_WALCHECKPOINTER_H
+#define LUASQLGEN_WALCHECKPOINTER_H
+
+#include "SQLiteConnection.h"
+#include <chrono>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <filesystem>
+#include <atomic>
+
+namespace luasqlgen
+{
+
+enum CHECKPOINT_MODE
+{
+	CHECKPOINT_PASSIVE = SQLITE_CHECKPOINT_PASSIVE,
+	CHECKPOINT_FULL = SQLITE_CHECKPOINT_FULL,
+	CHECKPOINT_RESTART = SQLITE_CHECKPOINT_RESTART,
+	CHECKPOINT_TRUNCATE = SQLITE_CHECKPOINT_TRUNCATE
+};
+
+struct CheckpointMetrics
+{
+	unsigned long long passive = 0;
+	unsigned long long restart = 0;
+	unsigned long long truncate = 0;
+	unsigned long long busy = 0; // Checkpoints which could not finish because of readers or writers
+
+	std::chrono::microseconds lastDuration{0};
+	std::chrono::microseconds maxDuration{0};
+	std::chrono::microseconds totalDuration{0};
+
+	size_t walSize = 0; // Bytes, as observed before the last checkpoint
+	int logFrames = 0; // Frames in the WAL after the last checkpoint
+	int checkpointedFrames = 0; // Frames of those which were written back to the database
+
+	unsigned long long errors = 0; // Checkpoints of the background thread which failed
+	std::string lastError;
+};
+
+struct CheckpointOptions
+{
+	std::chrono::milliseconds pollInterval{100}; // How often the pending frames are checked
+	std::chrono::milliseconds interval{5000}; // Longest time between checkpoints while frames are pending
+	size_t walSizeLimit = 4 << 20; // Bytes of pending frames which start a checkpoint right away
+	size_t truncateSize = 64 << 20; // Size of the WAL file from which on it is truncated
+	unsigned int escalateAfter = 3;
+	int busyTimeout = 100; // Milliseconds RESTART and TRUNCATE checkpoints wait for readers
+};
+
+/**
+ * Moves WAL checkpoints off the serving connection.
+ *
+ * Disables automatic checkpoints on the given connection and checkpoints from its own connection
+ * on a background thread instead: periodically, or earlier once walSizeLimit bytes of frames are
+ * pending. Frames are counted through a WAL hook, so only commits of the serving connection start
+ * checkpoints. Checkpoints start out PASSIVE, so they never block. If readers keep them from finishing
+ * escalateAfter times in a row, or the WAL file grew past truncateSize, a RESTART or TRUNCATE
+ * checkpoint is run which waits for the busy timeout.
+ *
+ * The serving connection has to outlive the checkpointer and must not be used by other threads
+ * while the checkpointer is created or destroyed. The background thread needs SQLite's mutexes,
+ * so the process must not be configured with THREADING_SINGLE.
+ */
+class WALCheckpointer
+{
+	SQLiteConnection& m_serving;
+	sqlite3* m_database = nullptr;
+	std::string m_walPath;
+	CheckpointOptions m_options;
+	int m_savedAutoCheckpoint = 0;
+
+	std::mutex m_mutex;
+	std::condition_variable m_cv;
+	bool m_stop = false;
+	std::thread m_thread;
+
+	std::mutex m_metricsMutex;
+	CheckpointMetrics m_metrics;
+	std::atomic<unsigned int> m_incomplete{0};
+
+	// Frames which were committed but not yet checkpointed, and the frames in the WAL at the last commit
+	std::atomic<unsigned long long> m_pendingFrames{0};
+	std::atomic<int> m_walFrames{0};
+	size_t m_pageSize = 0;
+
+	void onCommit(int frames)
+	{
+		// A WAL which was checkpointed completely starts over with the next commit
+		const int previous = m_walFrames.exchange(frames);
+		m_pendingFrames += frames > previous ? frames - previous : frames;
+	}
+
+	// Serializes checkpoints started by the thread and by checkpointNow()
+	std::mutex m_checkpointMutex;
+
+	void run()
+	{
+		auto last = std::chrono::steady_clock::now();
+		std::unique_lock<std::mutex> lock(m_mutex);
+		while(!m_cv.wait_for(lock, m_options.pollInterval, [this]() { return m_stop; }))
+		{
+			lock.unlock();
+
+			// The WAL file does not shrink before it is truncated, so only its pending frames count
+			const unsigned long long pending = m_pendingFrames;
+			const bool due = std::chrono::steady_clock::now() - last >= m_options.interval;
+			const bool oversized = getWalSize() >= m_options.truncateSize;
+			if((pending > 0 && (due || pending * m_pageSize >= m_options.walSizeLimit)) || (oversized && due))
+			{
+				CHECKPOINT_MODE mode = CHECKPOINT_PASSIVE;
+				if(oversized)
+					mode = CHECKPOINT_TRUNCATE;
+				else if(m_incomplete >= m_options.escalateAfter)
+					mode = CHECKPOINT_RESTART;
+
+				try
+				{
+					checkpointNow(mode);
+				}
+				catch(const std::exception& e)
+				{
+					std::lock_guard<std::mutex> metricsLock(m_metricsMutex);
+					m_metrics.errors++;
+					m_metrics.lastError = e.what();
+				}
+
+				last = std::chrono::steady_clock::now();
+			}
+
+			lock.lock();
+		}
+	}
+
+public:
+	WALCheckpointer(SQLiteConnection& serving, const CheckpointOptions& options = CheckpointOptions()):
+		m_serving(serving), m_walPath(serving.getFileName() + "-wal"), m_options(options)
+	{
+		if(serving.getFileName() == ":memory:")
+			throw std::runtime_error("In-memory databases have no WAL to checkpoint!");
+
+		m_savedAutoCheckpoint = serving.getAutoCheckpoint();
+
+		if(sqlite3_open_v2(serving.getFileName().c_str(), &m_database, SQLITE_OPEN_READWRITE, nullptr) != SQLITE_OK)
+		{
+			const std::string msg = std::string("Could not open checkpoint connection: ") + sqlite3_errmsg(m_database);
+			sqlite3_close(m_database);
+			throw std::runtime_error(msg);
+		}
+
+		// A fresh connection only notices the WAL once it reads the database, until then checkpoints do nothing
+		if(sqlite3_exec(m_database, "PRAGMA journal_mode=WAL;", nullptr, nullptr, nullptr) != SQLITE_OK)
+		{
+			const std::string msg = std::string("Could not enable WAL on checkpoint connection: ") + sqlite3_errmsg(m_database);
+			sqlite3_close(m_database);
+			throw std::runtime_error(msg);
+		}
+
+		sqlite3_busy_timeout(m_database, m_options.busyTimeout);
+		m_pageSize = serving.getStatus().pageSize;
+		m_serving.setWalHook([this](int frames) { onCommit(frames); });
+		m_thread = std::thread([this]() { run(); });
+	}
+
+	~WALCheckpointer()
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_stop = true;
+		}
+
+		m_cv.notify_all();
+		m_thread.join();
+		sqlite3_close(m_database);
+		m_serving.setWalHook(nullptr);
+		m_serving.setAutoCheckpoint(m_savedAutoCheckpoint);
+	}
+
+	WALCheckpointer(const WALCheckpointer&) = delete;
+	WALCheckpointer& operator=(const WALCheckpointer&) = delete;
+
+	size_t getWalSize() const
+	{
+		std::error_code error;
+		const auto size = std::filesystem::file_size(m_walPath, error);
+		return error ? 0 : size;
+	}
+
+	// Runs a checkpoint right away, returns false if it could not checkpoint the whole WAL.
+	bool checkpointNow(CHECKPOINT_MODE mode = CHECKPOINT_PASSIVE)
+	{
+		std::lock_guard<std::mutex> checkpointLock(m_checkpointMutex);
+
+		const size_t size = getWalSize();
+		const auto start = std::chrono::steady_clock::now();
+
+		int logFrames = 0, checkpointedFrames = 0;
+		const int rc = sqlite3_wal_checkpoint_v2(m_database, nullptr, mode, &logFrames, &checkpointedFrames);
+		const auto duration = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+
+		if(rc != SQLITE_OK && rc != SQLITE_BUSY)
+			throw std::runtime_error(std::string("Could not checkpoint WAL: ") + sqlite3_errmsg(m_database));
+
+		// With PASSIVE, frames stay behind whenever readers still use them
+		const bool complete = rc == SQLITE_OK && logFrames == checkpointedFrames;
+
+		std::lock_guard<std::mutex> lock(m_metricsMutex);
+		switch(mode)
+		{
+			case CHECKPOINT_RESTART: m_metrics.restart++; break;
+			case CHECKPOINT_TRUNCATE: m_metrics.truncate++; break;
+			default: m_metrics.passive++; break;
+		}
+
+		if(rc == SQLITE_BUSY)
+			m_metrics.busy++;
+
+		if(complete)
+		{
+			m_incomplete = 0;
+			m_pendingFrames = 0;
+		}
+		else
+		{
+			m_incomplete++;
+			if(checkpointedFrames >= 0 && logFrames >= checkpointedFrames)
+				m_pendingFrames = logFrames - checkpointedFrames;
+		}
+		m_metrics.lastDuration = duration;
+		m_metrics.maxDuration = std::max(m_metrics.maxDuration, duration);
+		m_metrics.totalDuration += duration;
+		m_metrics.walSize = size;
+		m_metrics.logFrames = logFrames;
+		m_metrics.checkpointedFrames = checkpointedFrames;
+		return complete;
+	}
+
+	CheckpointMetrics getMetrics()
+	{
+		std::lock_guard<std::mutex> lock(m_metricsMutex);
+		return m_metrics;
+	}
+};
+
+}
+
+#endif
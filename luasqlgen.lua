@@ -73,13 +73,29 @@ function string:escape()
 end
 
 local cpptypes = {
-	string = true, double = true, float = true, bool = true, int = true, uint = true, uint64 = true
+	string = true, double = true, float = true, bool = true, int = true, uint = true, uint64 = true, blob = true
 }
 
 local sql = dofile(scriptPath() .. "/sql.lua")
 local basePath = arg[1]:sub(0, arg[1]:len() - arg[1]:reverse():find("/"))
 local description = dofile(arg[1])
 local tables = description.tables
+sql:setDescription(description)
+
+-- C++ functions and aggregates registered with SQLite, see registerFunctions
+local functions = description.functions or {}
+local aggregates = description.aggregates or {}
+local hasFunctions = next(functions) ~= nil or next(aggregates) ~= nil
+
+-- C++ type of the struct member generated for a field type
+function cppType(type)
+	if tables[type] ~= nil then
+		return "unsigned int"
+	elseif cpptypes[type] then
+		return type
+	end
+	return "unsigned long long"
+end
 
 -- Write structs
 -- Open as binary since Windows likes to convert '\n' to '\r\n' which messes up some offsets for fseek
@@ -89,9 +105,22 @@ structfile:write([[
 #pragma once
 
 #include <DatabaseConnection.h>
+#include <Transaction.h>
+#include <CSVLoader.h>
+#include <TableExport.h>
+#include <Predicate.h>
+#include <FullTextSearch.h>
+#include <ObjectCache.h>
+#include <ResultCache.h>
+]] .. (hasFunctions and "#include <SQLiteConnection.h>\n" or "") .. [[
 
 #include <string>
 #include <cstdint>
+#include <cstring>
+#include <algorithm>
+#include <unordered_map>
+#include <unordered_set>
+#include <optional>
 #include <regex>
 
 // For toJson
@@ -104,6 +133,7 @@ using std::string;
 typedef uint32_t uint;
 typedef int64_t int64;
 typedef uint64_t uint64;
+typedef luasqlgen::Blob blob;
 
 ]])
 
@@ -116,6 +146,8 @@ for k,v in orderedPairs(tables) do
 	for p,q in orderedPairs(v) do
 		if q == "string" then
 			toJsonString = toJsonString .. "\t\t" .. [[ss << "\"]] .. p .. [[\" : \"" << luasqlgen::PreparedStmt::jsonEscape(]] .. p .. ") << \"\\\",\" << std::endl;\n";
+		elseif q == "blob" then
+			toJsonString = toJsonString .. "\t\t" .. [[ss << "\"]] .. p .. [[\" : \"" << luasqlgen::blobToHex(]] .. p .. ") << \"\\\",\" << std::endl;\n";
 		else
 			toJsonString = toJsonString .. "\t\t" .. [[ss << "\"]] .. p .. [[\" : \"" << ]] .. p .. " << \"\\\",\" << std::endl;\n";
 		end
@@ -127,9 +159,9 @@ for k,v in orderedPairs(tables) do
 				structfile:write("\tunsigned int " .. p .. " = 0;\n")
 			end
 		else
-			 if q ~= "string" and cpptypes[q] then -- If we have a C++ basic type that is no string
+			 if q ~= "string" and q ~= "blob" and cpptypes[q] then -- If we have a C++ basic type that is no string
 				structfile:write("\t" .. q .. " " .. p .. " = 0;\n")
-			 elseif q == "string" then -- If we have a string
+			 elseif q == "string" or q == "blob" then -- If we have a string
 				structfile:write("\t" .. q .. " " .. p .. ";\n")
 			 else -- If we have a non-existing custom type (e.g. reference to table from another module)
 				 structfile:write("\tunsigned long long " .. p .. ";\n")
@@ -137,6 +169,27 @@ for k,v in orderedPairs(tables) do
 		end
 	end
 
+	-- Dirty field tracking, setters mark a field as changed for update<T>Partial
+	structfile:write("\n\tuint64_t dirtyFields = 0;\n")
+	local fieldIndex = 0
+	for p,q in orderedPairs(v) do
+		if fieldIndex >= 64 then
+			print("Table " .. k .. " has more than 64 fields which is not supported by dirty field tracking")
+			os.exit(1)
+		end
+		structfile:write("\tstatic constexpr uint64_t " .. p .. "Field = 1ull << " .. fieldIndex .. ";\n")
+		fieldIndex = fieldIndex + 1
+	end
+
+	structfile:write("\n")
+	for p,q in orderedPairs(v) do
+		local paramType = cppType(q)
+		if paramType == "string" or paramType == "blob" then
+			paramType = "const " .. paramType .. "&"
+		end
+		structfile:write("\tvoid set" .. p .. "(" .. paramType .. " value) { " .. p .. " = value; dirtyFields |= " .. p .. "Field; }\n")
+	end
+
    structfile:write("\n\tvoid validate()\n\t{\n")
    structfile:write("\t\t// Integrity check\n")
    if description.checks ~= nil and description.checks[k] ~= nil then
@@ -167,23 +220,128 @@ for k,v in orderedPairs(tables) do
 	end
 
 	structfile:write("};\n\n")
+
+	-- Typed predicate builder used by find<T>
+	local predicateName = k .. "Predicate"
+	structfile:write("struct " .. predicateName .. " : public luasqlgen::Predicate\n{\n")
+
+	local predicateFields = { { "id", "unsigned long long" } }
+	for p,q in orderedPairs(v) do
+		-- Blobs can not be compared in a meaningful way
+		if q ~= "blob" then
+			table.insert(predicateFields, { p, cppType(q) })
+		end
+	end
+
+	for i, field in ipairs(predicateFields) do
+		local p, paramType = field[1], field[2]
+		local arg = "std::to_string(value)"
+		if paramType == "string" then
+			paramType = "const string&"
+			arg = "value"
+		end
+
+		local function writeMethod(suffix, params, body)
+			structfile:write("\t" .. predicateName .. "& " .. p .. suffix .. "(" .. params .. ") { " .. body .. " return *this; }\n")
+		end
+
+		for j, op in ipairs({ { "Eq", "=" }, { "Ne", "<>" }, { "Lt", "<" }, { "Le", "<=" }, { "Gt", ">" }, { "Ge", ">=" } }) do
+			writeMethod(op[1], paramType .. " value", "add(\"" .. p .. "\", \"" .. op[2] .. "\", " .. arg .. ");")
+		end
+
+		writeMethod("Between", paramType .. " low, " .. paramType .. " high",
+			"addBetween(\"" .. p .. "\", " .. arg:gsub("value", "low") .. ", " .. arg:gsub("value", "high") .. ");")
+		writeMethod("In", "const std::vector<" .. field[2] .. ">& values", "addIn(\"" .. p .. "\", values);")
+
+		if field[2] == "string" then
+			writeMethod("Like", paramType .. " value", "add(\"" .. p .. "\", \"like\", value);")
+		end
+
+		structfile:write("\n")
+	end
+
+	structfile:write("\t// Raw SQL condition, e.g. calling a registered function. Never put user input into sql, bind it with '?'.\n")
+	structfile:write("\t" .. predicateName .. "& expression(const string& sql, const std::vector<string>& args = {}) { addExpression(sql, args); return *this; }\n\n")
+
+	structfile:seek("cur", -1)
+	structfile:write("};\n\n")
+end
+
+-- Companion structs for load<T>With<F>, holding a row together with the row its reference field points to
+for k,v in orderedPairs(tables) do
+	for p,q in orderedPairs(v) do
+		if tables[q] ~= nil and p ~= q then
+			structfile:write("struct " .. k .. "With" .. p .. "\n{\n")
+			structfile:write("\t" .. k .. " object;\n")
+			structfile:write("\t" .. q .. " " .. p .. ";\n")
+			structfile:write("\tbool " .. p .. "Found = false; // False if the referenced row does not exist\n")
+			structfile:write("};\n\n")
+		end
+	end
 end
+
 structfile:write("class " .. description.name .. "\n{\n")
 structfile:write([[
 private:
 	std::shared_ptr<luasqlgen::DatabaseConnection> m_connection;
 ]])
 
+for k,v in orderedPairs(tables) do
+	structfile:write("\tstd::unique_ptr<luasqlgen::ObjectCache<" .. k .. ">> m_" .. k .. "Cache;\n")
+end
+structfile:write("\tstd::unique_ptr<luasqlgen::ResultCache> m_resultCache;\n")
+structfile:write("\tstd::vector<std::unique_ptr<luasqlgen::Transaction>> m_transactions; // Opened by begin()\n\n")
+
+structfile:write([[
+	// The transaction is dropped in any case, so it rolls back on its own if finishing it fails
+	std::unique_ptr<luasqlgen::Transaction> popTransaction()
+	{
+		if(m_transactions.empty())
+			throw std::runtime_error("No transaction was started with begin()!");
+
+		std::unique_ptr<luasqlgen::Transaction> transaction = std::move(m_transactions.back());
+		m_transactions.pop_back();
+		return transaction;
+	}
+
+]])
+
+local tableCount = 0
+for k,v in pairs(tables) do
+	tableCount = tableCount + 1
+end
+
+structfile:write("\tvoid clearCaches()\n\t{\n")
+structfile:write("\t\tif(m_resultCache) m_resultCache->clear();\n")
+for k,v in orderedPairs(tables) do
+	structfile:write("\t\tif(m_" .. k .. "Cache) m_" .. k .. "Cache->clear();\n")
+end
+structfile:write("\t}\n\n")
+
 structfile:write("public:\n")
 structfile:write("\t" .. description.name .. "(const std::shared_ptr<luasqlgen::DatabaseConnection>& conn) : m_connection(conn) {}\n")
 
 for k,v in orderedPairs(tables) do
+	sql:generateCacheFunctions(structfile, k, v)
 	sql:generateCreateFunction(structfile, k, v)
 	sql:generateGetFunction(structfile, k, v)
+	sql:generateGetManyFunctions(structfile, k, v)
 	sql:generateUpdateFunction(structfile, k, v)
+	sql:generatePartialUpdateFunction(structfile, k, v)
+	sql:generateUpsertFunction(structfile, k, v)
 	sql:generateDeleteFunction(structfile, k, v)
+	sql:generateDeleteManyFunction(structfile, k, v)
+	sql:generateUpdateManyFunction(structfile, k, v)
 	sql:generateQueryFunction(structfile, k, v)
 	sql:generateSearchFunction(structfile, k, v)
+	sql:generateFindFunctions(structfile, k, v)
+	sql:generateProjectionFunctions(structfile, k, v)
+	sql:generateAggregateFunctions(structfile, k, v)
+	sql:generateEagerLoadFunctions(structfile, k, v)
+	sql:generatePageFunctions(structfile, k, v)
+	sql:generateLoadCSVFunction(structfile, k, v)
+	sql:generateExportFunction(structfile, k, v)
+	sql:generateBlobFunctions(structfile, k, v)
 end
 
 -- Write scripts
@@ -205,23 +363,89 @@ if description.scripts ~= nil then
 		slashLocStart = slashLocStart or file:len() + 2
 		slashLocStart = file:len() - slashLocStart + 2
 
-		structfile:write("\tvirtual std::string " .. file:sub(slashLocStart, file:find(".sql") - 1) .. "(const std::vector<std::string>& args)\n\t{\n")
+		local scriptName = file:sub(slashLocStart, file:find(".sql") - 1)
+
+		-- Tables the script mentions, their versions decide whether a cached result is still valid
+		local lowerSources = sources:lower()
+		local dependencies = {}
+		for k,v in orderedPairs(tables) do
+			if lowerSources:find("%f[%w_]" .. k:lower() .. "%f[^%w_]") then
+				table.insert(dependencies, k)
+			end
+		end
+
+		local writes = false
+		for _, keyword in ipairs({"insert", "update", "delete", "replace", "create", "drop", "alter"}) do
+			if lowerSources:find("%f[%w_]" .. keyword .. "%f[^%w_]") then
+				writes = true
+			end
+		end
+
+		structfile:write("\tvirtual std::string " .. scriptName .. "(const std::vector<std::string>& args)\n\t{\n")
 		local lines = {}
 		for match in sources:gmatch("(.-);") do
-			table.insert(lines, "m_connection->queryJson(\"" .. match:escape() .. "\", args);\n");
+			table.insert(lines, "m_connection->persistent().queryJson(\"" .. match:escape() .. "\", args);\n");
 		end
 
-		for k, v in ipairs(lines) do
-			if k == #lines then
-				structfile:write("\t\treturn " .. v)
-			else
-				structfile:write("\t\t" .. v)
+		if writes then
+			-- Scripts changing data are never cached but invalidate results depending on their tables
+			for k, v in ipairs(lines) do
+				if k == #lines then
+					structfile:write("\t\tstd::string result = " .. v)
+				else
+					structfile:write("\t\t" .. v)
+				end
+			end
+
+			for _, dependency in ipairs(dependencies) do
+				structfile:write("\t\ttouch" .. dependency .. "();\n")
 			end
+			structfile:write("\t\treturn result;\n")
+		else
+			local indexes = {}
+			for _, dependency in ipairs(dependencies) do
+				table.insert(indexes, sql:getTableIndex(dependency))
+			end
+
+			structfile:write([[
+		static const std::vector<size_t> tables = {]] .. table.concat(indexes, ", ") .. [[};
+		std::string key;
+		std::vector<unsigned long long> versions;
+		if(m_resultCache)
+		{
+			key = luasqlgen::ResultCache::makeKey("]] .. scriptName .. [[", args);
+			std::string cached;
+			if(m_resultCache->get(key, tables, cached)) return cached;
+			versions = m_resultCache->getVersions(tables);
+		}
+
+]])
+			for k, v in ipairs(lines) do
+				if k == #lines then
+					structfile:write("\t\tstd::string result = " .. v)
+				else
+					structfile:write("\t\t" .. v)
+				end
+			end
+
+			structfile:write([[
+
+		// Results read inside of a transaction might still be rolled back
+		if(m_resultCache && !m_connection->getTransactionDepth())
+			m_resultCache->put(key, std::move(versions), result);
+
+		return result;
+]])
 		end
 		structfile:write("\t}\n\n")
 
 		structfile:write("\tvirtual void " .. file:sub(slashLocStart, file:find(".sql") - 1) .. "(const std::vector<std::string>& args, luasqlgen::DatabaseResult& result)\n\t{\n")
-		structfile:write("\t\tm_connection->query(\"" .. sources:escape() .. "\", args, result);\n");
+		structfile:write("\t\tm_connection->persistent().query(\"" .. sources:escape() .. "\", args, result);\n");
+		if writes then
+			for _, dependency in ipairs(dependencies) do
+				structfile:write("\t\ttouch" .. dependency .. "();\n")
+			end
+		end
 		structfile:write("\t}\n\n")
 
 		-- structfile:write(
@@ -235,9 +459,30 @@ end
 
 structfile:write(
 [[
-	virtual void begin() { m_connection->query("begin;"); }
-	virtual void commit() { m_connection->query("commit;"); }
-	virtual void rollback() { m_connection->query("rollback;"); }
+	// Same as transaction(), but without a scope. Objects read in between are not cached.
+	virtual void begin() { m_transactions.push_back(std::make_unique<luasqlgen::Transaction>(*m_connection)); }
+	virtual void commit() { popTransaction()->commit(); }
+	virtual void rollback() { popTransaction()->rollback(); }
+
+	// Caches the JSON results of script functions for up to ttl. Results are dropped as soon as a table
+	// the script reads is changed through this class.
+	void enableResultCache(std::chrono::milliseconds ttl, size_t capacity = 1024)
+	{
+		m_resultCache.reset(new luasqlgen::ResultCache(]] .. tableCount .. [[, ttl, capacity));
+	}
+
+	void disableResultCache() { m_resultCache.reset(); }
+
+	luasqlgen::CacheStats getResultCacheStats()
+	{
+		return m_resultCache ? m_resultCache->getStats() : luasqlgen::CacheStats();
+	}
+
+	// Scoped transaction, nested calls are mapped to savepoints. Rolled back unless committed.
+	luasqlgen::Transaction transaction(luasqlgen::TRANSACTION_MODE mode = luasqlgen::DEFERRED)
+	{
+		return luasqlgen::Transaction(*m_connection, mode);
+	}
 	
 	virtual void installMariaDB()
 	{
@@ -258,6 +503,26 @@ structfile:write(
 	}
 ]])
 
+if hasFunctions then
+	structfile:write([[
+
+	// Registers the functions and aggregates of the description on the connection, which has to be
+	// done after every connect. Only SQLite supports them, returns false for other backends.
+	bool registerFunctions()
+	{
+		auto sqlite = dynamic_cast<luasqlgen::SQLiteConnection*>(m_connection.get());
+		if(!sqlite) return false;
+
+]])
+	for name, impl in orderedPairs(functions) do
+		structfile:write("\t\tsqlite->createFunction(\"" .. name .. "\", " .. impl .. ");\n")
+	end
+	for name, impl in orderedPairs(aggregates) do
+		structfile:write("\t\tsqlite->createAggregate<" .. impl .. ">(\"" .. name .. "\");\n")
+	end
+	structfile:write("\t\treturn true;\n\t}\n\n")
+end
+
 structfile:write("void dropTablesMariaDB()\n{\n")
 for k,v in orderedPairs(tables) do
 	structfile:write("m_connection->query(\"drop table " .. k .. ";\");\n")
@@ -274,6 +539,9 @@ structfile:write("}\n")
 structfile:write("void dropTablesSQLite()\n{\n")
 for k,v in orderedPairs(tables) do
 	structfile:write("m_connection->query(\"drop table " .. k .. ";\");\n")
+	if sql:getSearchFields(k, v) then
+		structfile:write("m_connection->query(\"drop table if exists " .. k .. "_fts;\");\n")
+	end
 end
 structfile:write("}\n")
 
@@ -287,6 +555,7 @@ structfile:write("}\n")
 structfile:write([[
 	virtual void dropTables()
 	{
+		clearCaches();
 		if(!strcmp(m_connection->getName(), "MariaDB"))
 			dropTablesMariaDB();
 		else
@@ -295,6 +564,7 @@ structfile:write([[
 	
 	virtual void clearTables()
 	{
+		clearCaches();
 		if(!strcmp(m_connection->getName(), "MariaDB"))
 			clearTablesMariaDB();
 		else
@@ -1,29 +1,181 @@
 
 local SQL = {}
 
-function SQL:generateCreateFunction(file, name, tbl)
+-- Writes the conversion of a result row into object. If name is given, only the fields
+-- selected by the field mask "fields" of struct name are converted.
+local function writeRowDecode(file, indent, tbl, name)
+	file:write(indent .. "object.id = std::stoull(row[\"id\"]);\n")
+	for p,q in orderedPairs(tbl) do
+		if name then
+			file:write(indent .. "if(fields & " .. name .. "::" .. p .. "Field)\n\t")
+		end
 
-	file:write("\tvoid create" .. name .. "(struct " .. name .. "& self)\n\t{\n")
-	file:write("\t\tstd::vector<std::string> args = {")
+		if q == "string" then
+			file:write(indent .. "object." .. p .. " = std::move(row[\"" .. p .. "\"]);\n")
+		elseif q == "blob" then
+			file:write(indent .. "luasqlgen::toBlob(row[\"" .. p .. "\"], object." .. p .. ");\n")
+		elseif q == "float" then
+			file:write(indent .. "object." .. p .. " = std::stof(row[\"" .. p .. "\"]);\n")
+		elseif q == "double" then
+			file:write(indent .. "object." .. p .. " = std::stod(row[\"" .. p .. "\"]);\n")
+		else
+			file:write(indent .. "object." .. p .. " = std::stoll(row[\"" .. p .. "\"]);\n")
+		end
+	end
+end
 
-	local i = 0;
+function SQL:setDescription(description)
+	self.description = description
+end
+
+-- Returns the position of a table in the alphabetically ordered table list, starting at 0.
+function SQL:getTableIndex(name)
+	-- Not using orderedPairs since it can not be nested in a loop over the same table,
+	-- which also stores its state in the table while it runs
+	local names = {}
+	for k,v in pairs(self.description.tables) do
+		if k ~= "__orderedIndex" then
+			table.insert(names, k)
+		end
+	end
+	table.sort(names)
+
+	for i, k in ipairs(names) do
+		if k == name then
+			return i - 1
+		end
+	end
+end
+
+-- Returns the fields of a table which are covered by its full text index or nil if it has none.
+-- Tables are marked in description.searchable either with a list of fields or with true for all strings.
+function SQL:getSearchFields(name, tbl)
+	local searchable = self.description and self.description.searchable
+	if not searchable or not searchable[name] then
+		return nil
+	end
+
+	if searchable[name] ~= true then
+		return searchable[name]
+	end
+
+	local fields = {}
 	for p,q in orderedPairs(tbl) do
 		if q == "string" then
-			file:write("self." .. p .. ", ")
+			table.insert(fields, p)
+		end
+	end
+	return fields
+end
+
+-- FTS5 index with triggers keeping it in sync with the content table. Updates of other
+-- columns leave the index alone.
+local function generateSearchIndexSQLite(name, fields)
+	local fts = "`" .. name .. "_fts`"
+	local columns = "`" .. table.concat(fields, "`, `") .. "`"
+	local newValues = "new.`id`, new.`" .. table.concat(fields, "`, new.`") .. "`"
+	local oldValues = "'delete', old.`id`, old.`" .. table.concat(fields, "`, old.`") .. "`"
+	local insertNew = "\tinsert into " .. fts .. " (rowid, " .. columns .. ") values (" .. newValues .. ");\n"
+	local deleteOld = "\tinsert into " .. fts .. " (" .. fts .. ", rowid, " .. columns .. ") values (" .. oldValues .. ");\n"
+
+	return "create virtual table if not exists " .. fts .. " using fts5(" .. columns .. ", content='" .. name .. "', content_rowid='id');\n"
+		.. "create trigger if not exists `" .. name .. "_fts_insert` after insert on `" .. name .. "` begin\n" .. insertNew .. "end;\n"
+		.. "create trigger if not exists `" .. name .. "_fts_delete` after delete on `" .. name .. "` begin\n" .. deleteOld .. "end;\n"
+		.. "create trigger if not exists `" .. name .. "_fts_update` after update of " .. columns .. " on `" .. name .. "` begin\n" .. deleteOld .. insertNew .. "end;\n\n"
+end
+
+-- Returns the indexes of a table as a list of { fields = {...}, name = ..., unique = bool, where = ... }.
+-- Indexes are declared in description.indexes, reference fields (fields typed as another table)
+-- receive an index automatically unless an index starting with that field already exists.
+function SQL:getIndexes(name, tbl)
+	local result = {}
+	local covered = {}
+	local declared = (self.description and self.description.indexes and self.description.indexes[name]) or {}
+
+	for i, index in ipairs(declared) do
+		if #index == 0 then
+			print("Index without fields on " .. name)
+			os.exit(1)
+		end
+
+		local fields = {}
+		for j, field in ipairs(index) do
+			if tbl[field] == nil then
+				print("Index on unknown field " .. name .. "." .. field)
+				os.exit(1)
+			end
+			table.insert(fields, field)
+		end
+
+		covered[fields[1]] = true
+		table.insert(result, {
+			fields = fields,
+			name = name .. "_" .. table.concat(fields, "_") .. (index.where and "_partial" or "") .. "_idx",
+			unique = index.unique or false,
+			where = index.where
+		})
+	end
+
+	local tables = (self.description and self.description.tables) or {}
+	for p,q in orderedPairs(tbl) do
+		if tables[q] ~= nil and not covered[p] then
+			table.insert(result, { fields = { p }, name = name .. "_" .. p .. "_idx", unique = false })
+		end
+	end
+
+	return result
+end
+
+local function generateIndexSQLite(name, index)
+	local stmt = "create " .. (index.unique and "unique " or "") .. "index if not exists `" .. index.name .. "` on `" .. name
+		.. "` (`" .. table.concat(index.fields, "`, `") .. "`)"
+
+	if index.where then
+		stmt = stmt .. " where " .. index.where
+	end
+	return stmt .. ";\n"
+end
+
+-- MariaDB has no partial indexes, these become regular indexes. A unique partial index would
+-- reject duplicates outside of its condition, so it is not unique on MariaDB.
+-- Text columns can only be indexed with a prefix length.
+local function generateIndexMariaDB(name, tbl, index)
+	local columns = {}
+	for i, field in ipairs(index.fields) do
+		if tbl[field] == "string" or tbl[field] == "blob" then
+			table.insert(columns, "`" .. field .. "`(255)")
 		else
-			file:write("std::to_string(self." .. p .. "), ")
+			table.insert(columns, "`" .. field .. "`")
 		end
-		i = i + 1
 	end
-	file:seek("cur", -2)
 
-	file:write("};\n")
+	return "create " .. ((index.unique and not index.where) and "unique " or "") .. "index if not exists `" .. index.name
+		.. "` on `" .. name .. "` (" .. table.concat(columns, ", ") .. ");\n"
+end
 
-	file:write("\t\tm_connection->queryJson(")
+local function generateSearchIndexMariaDB(name, fields)
+	return ",\n\tfulltext key `" .. name .. "_fts` (`" .. table.concat(fields, "`, `") .. "`)"
+end
+
+function SQL:generateCreateFunction(file, name, tbl)
+
+	file:write("\tvoid create" .. name .. "(struct " .. name .. "& self)\n\t{\n")
+
+	-- Arguments refer to the members directly, nothing is copied or converted to strings
+	file:write("\t\tm_connection->persistent().queryRef(")
 	self:generateCreateStmt(file, name, tbl)
-	file:write(", args);\n")
+	file:write(", {")
+
+	for p,q in orderedPairs(tbl) do
+		file:write("self." .. p .. ", ")
+	end
+	file:seek("cur", -2)
+
+	file:write("});\n")
 
 	file:write("\t\tself.id = m_connection->getLastInsertID();\n")
+	file:write("\t\ttouch" .. name .. "();\n")
+	file:write("\t\tself.dirtyFields = 0;\n")
 	file:write("\t}\n\n")
 
 	file:write("\tvoid create(struct " .. name .. "& self) { create" .. name .. "(self);}\n\n")
@@ -32,67 +184,264 @@ end
 function SQL:generateUpdateFunction(file, name, tbl)
 
 	file:write("\tvoid update" .. name .. "(struct " .. name .. "& self)\n\t{\n")
-	file:write("\t\tstd::vector<std::string> args = {")
+	file:write("\t\tm_connection->persistent().queryRef(")
+	self:generateUpdateStmt(file, name, tbl)
+	file:write(", {")
 
-	local i = 0;
 	for p,q in orderedPairs(tbl) do
-
-		if q == "string" then
-			file:write("self." .. p .. ", ")
-		else
-			file:write("std::to_string(self." .. p .. "), ")
-		end
-		i = i + 1
+		file:write("self." .. p .. ", ")
 	end
-	file:seek("cur", -2)
 
-	file:write(", std::to_string(self.id) };\n")
-
-	file:write("\t\tm_connection->queryJson(")
-	self:generateUpdateStmt(file, name, tbl)
-	file:write(", args);\n")
+	file:write("self.id});\n")
 
 	--file:write("\t\tself.id = " .. stmtName .. "->insert();\n")
+	file:write("\t\tinvalidate" .. name .. "(self.id);\n")
+	file:write("\t\tself.dirtyFields = 0;\n")
 	file:write("\t}\n\n")
 	file:write("\tvoid update(struct " .. name .. "& self) { update" .. name .. "(self);}\n\n")
 end
 
+function SQL:generatePartialUpdateFunction(file, name, tbl)
+	file:write("\t// Only writes the fields marked in self.dirtyFields, every combination of fields uses its own cached statement.\n")
+	file:write("\tvoid update" .. name .. "Partial(struct " .. name .. "& self)\n\t{\n")
+	file:write("\t\tif(!self.dirtyFields) return;\n\n")
+	file:write("\t\tstd::string source = \"update `" .. name .. "` set \";\n")
+	file:write("\t\tluasqlgen::ArgViews args;\n")
+
+	for p,q in orderedPairs(tbl) do
+		file:write("\t\tif(self.dirtyFields & " .. name .. "::" .. p .. "Field) { source += \"`" .. p .. "` = ?,\"; args.push_back(self." .. p .. "); }\n")
+	end
+
+	file:write("\n\t\tsource.back() = ' ';\n")
+	file:write("\t\tsource += \"where `id` = ?;\";\n")
+	file:write("\t\targs.push_back(self.id);\n\n")
+	file:write("\t\tm_connection->queryRef(source, args);\n")
+	file:write("\t\tinvalidate" .. name .. "(self.id);\n")
+	file:write("\t\tself.dirtyFields = 0;\n")
+	file:write("\t}\n\n")
+end
+
+function SQL:generateUpsertFunction(file, name, tbl)
+	local columns = "`id`"
+	local values = "?"
+	local sqliteSet = ""
+	local mariadbSet = ""
+
+	file:write("\t// Inserts the object or overwrites the row with the same id. Objects without an id are created.\n")
+	file:write("\tvoid upsert" .. name .. "(struct " .. name .. "& self)\n\t{\n")
+	file:write("\t\tif(!self.id)\n\t\t{\n\t\t\tcreate" .. name .. "(self);\n\t\t\treturn;\n\t\t}\n\n")
+	file:write("\t\tconst luasqlgen::ArgViews args = {self.id")
+
+	for p,q in orderedPairs(tbl) do
+		file:write(", self." .. p)
+		columns = columns .. ", `" .. p .. "`"
+		values = values .. ",?"
+		sqliteSet = sqliteSet .. "`" .. p .. "` = excluded.`" .. p .. "`, "
+		mariadbSet = mariadbSet .. "`" .. p .. "` = values(`" .. p .. "`), "
+	end
+	file:write("};\n\n")
+
+	local insert = "insert into `" .. name .. "` (" .. columns .. ") values (" .. values .. ")"
+	if sqliteSet == "" then
+		sqliteSet = " on conflict(`id`) do nothing;"
+		mariadbSet = " on duplicate key update `id` = `id`;"
+	else
+		sqliteSet = " on conflict(`id`) do update set " .. sqliteSet:sub(1, -3) .. ";"
+		mariadbSet = " on duplicate key update " .. mariadbSet:sub(1, -3) .. ";"
+	end
+
+	file:write("\t\tif(!strcmp(m_connection->getName(), \"MariaDB\"))\n")
+	file:write("\t\t\tm_connection->persistent().queryRef(\"" .. insert .. mariadbSet .. "\", args);\n")
+	file:write("\t\telse\n")
+	file:write("\t\t\tm_connection->persistent().queryRef(\"" .. insert .. sqliteSet .. "\", args);\n\n")
+	file:write("\t\tinvalidate" .. name .. "(self.id);\n")
+	file:write("\t\tself.dirtyFields = 0;\n")
+	file:write("\t}\n\n")
+
+	file:write("\tvoid upsert(struct " .. name .. "& self) { upsert" .. name .. "(self);}\n\n")
+end
+
 function SQL:generateDeleteFunction(file, name, tbl)
 	file:write("\tvoid delete" .. name .. "(unsigned long long id)\n\t{\n")
-	file:write("\t\tm_connection->queryJson(\"delete from `" .. name .. "` where id = ?;\", {std::to_string(id)});\n")
+	file:write("\t\tm_connection->persistent().queryJson(\"delete from `" .. name .. "` where id = ?;\", {std::to_string(id)});\n")
+	file:write("\t\tinvalidate" .. name .. "(id);\n")
 	file:write("\t}\n\n")
 
 	file:write("\tvoid remove(struct " .. name .. "& self) { delete" .. name .. "(self.id);}\n\n")
 end
 
+function SQL:generateDeleteManyFunction(file, name, tbl)
+	file:write("\t// Deletes all given ids using one statement per chunk of getBatchSize() ids.\n")
+	file:write("\tvoid deleteMany" .. name .. "(const std::vector<unsigned long long>& ids)\n\t{\n")
+	file:write("\t\tif(ids.empty()) return;\n\n")
+	file:write("\t\tconst size_t chunkSize = std::min(m_connection->getBatchSize(), ids.size());\n")
+	file:write("\t\tconst std::string source = \"delete from `" .. name .. "` where id in (\" + luasqlgen::makePlaceholders(chunkSize) + \");\";\n")
+	file:write("\t\tstd::vector<std::string> args(chunkSize);\n\n")
+	file:write("\t\tfor(size_t offset = 0; offset < ids.size(); offset += chunkSize)\n\t\t{\n")
+	file:write("\t\t\t// The last chunk is padded by repeating its last id so all chunks share one statement\n")
+	file:write("\t\t\tfor(size_t i = 0; i < chunkSize; i++)\n")
+	file:write("\t\t\t\targs[i] = std::to_string(ids[std::min(offset + i, ids.size() - 1)]);\n\n")
+	file:write("\t\t\tm_connection->queryJson(source, args);\n")
+	file:write("\t\t}\n\n")
+	file:write("\t\tfor(auto id : ids)\n")
+	file:write("\t\t\tinvalidate" .. name .. "(id);\n")
+	file:write("\t}\n\n")
+end
+
+function SQL:generateUpdateManyFunction(file, name, tbl)
+	file:write("\t// Updates all objects, every chunk of getBatchSize() objects is written in one transaction.\n")
+	file:write("\tvoid updateMany" .. name .. "(std::vector<" .. name .. ">& objects)\n\t{\n")
+	file:write("\t\tconst size_t chunkSize = m_connection->getBatchSize();\n")
+	file:write("\t\tfor(size_t offset = 0; offset < objects.size(); offset += chunkSize)\n\t\t{\n")
+	file:write("\t\t\tluasqlgen::Transaction transaction(*m_connection);\n")
+	file:write("\t\t\tconst size_t end = std::min(offset + chunkSize, objects.size());\n")
+	file:write("\t\t\tfor(size_t i = offset; i < end; i++)\n")
+	file:write("\t\t\t\tupdate" .. name .. "(objects[i]);\n\n")
+	file:write("\t\t\ttransaction.commit();\n")
+	file:write("\t\t}\n")
+	file:write("\t}\n\n")
+end
+
 function SQL:generateGetFunction(file, name, tbl)
 	-- print("Generating get" .. name)
 	file:write("\tbool get" .. name .. "(unsigned long long id, " .. name .. "& object)\n\t{\n")
+	file:write("\t\tif(m_" .. name .. "Cache && m_" .. name .. "Cache->get(id, object)) return true;\n\n")
 
 	--file:write("\t\t" .. db:setStatementArg(stmtName, 0, "id", "uint64") .. "\n")
 	file:write("\t\tluasqlgen::DatabaseResult result;\n")
-	file:write("\t\tm_connection->query(\"select * from `" .. name .. "` where id = ?;\", {std::to_string(id)}, result);\n\n")
+	file:write("\t\tm_connection->persistent().query(\"select * from `" .. name .. "` where id = ?;\", {std::to_string(id)}, result);\n\n")
 
 	file:write("\t\tif(result.empty()) return false;\n\n")
 
 	file:write("\t\tauto& row = result[0];\n");
-	file:write("\t\tobject.id = id;\n")
+	file:write("\t\tobject.dirtyFields = 0;\n")
+	writeRowDecode(file, "\t\t", tbl)
 
+	--file:write("\t\t" .. db:generateStmtReset(stmtName) .. "\n")
+	file:write("\n\t\t// Rows read inside of a transaction might still be rolled back\n")
+	file:write("\t\tif(m_" .. name .. "Cache && !m_connection->getTransactionDepth())\n")
+	file:write("\t\t\tm_" .. name .. "Cache->put(id, object);\n")
+	file:write("\n\t\treturn true;\n\t}\n\n")
+	file:write("\t bool get(unsigned long long id, struct " .. name .. "& self) { return get" .. name .. "(id, self);}\n\n")
+end
+
+function SQL:generateCacheFunctions(file, name, tbl)
+	local sizeOf = "sizeof(" .. name .. ")"
 	for p,q in orderedPairs(tbl) do
-		if q == "string" then
-			file:write("\t\tobject." .. p .. " = std::move(row[\"" .. p .. "\"]);\n")
-		elseif q == "float" then
-			file:write("\t\tobject." .. p .. " = std::stof(row[\"" .. p .. "\"]);\n")
-		elseif q == "double" then
-			file:write("\t\tobject." .. p .. " = std::stod(row[\"" .. p .. "\"]);\n")
-		else
-			file:write("\t\tobject." .. p .. " = std::stoll(row[\"" .. p .. "\"]);\n")
+		if q == "string" or q == "blob" then
+			sizeOf = sizeOf .. " + object." .. p .. ".capacity()"
 		end
 	end
 
-	--file:write("\t\t" .. db:generateStmtReset(stmtName) .. "\n")
-	file:write("\n\t\treturn true;\n\t}\n\n")
-	file:write("\t bool get(unsigned long long id, struct " .. name .. "& self) { return get" .. name .. "(id, self);}\n\n")
+	file:write([[
+	// Keeps up to capacity objects returned by get]] .. name .. [[ in memory. Writes through this class
+	// invalidate their entries, changes made by other processes are not noticed.
+	void enable]] .. name .. [[Cache(size_t capacity, size_t shards = 16)
+	{
+		m_]] .. name .. [[Cache.reset(new luasqlgen::ObjectCache<]] .. name .. [[>(capacity, shards,
+			[](const ]] .. name .. [[& object) -> size_t { return ]] .. sizeOf .. [[; }));
+	}
+
+	void disable]] .. name .. [[Cache() { m_]] .. name .. [[Cache.reset(); }
+
+	luasqlgen::CacheStats get]] .. name .. [[CacheStats() const
+	{
+		return m_]] .. name .. [[Cache ? m_]] .. name .. [[Cache->getStats() : luasqlgen::CacheStats();
+	}
+
+	// Marks cached script results reading this table as stale
+	void touch]] .. name .. [[()
+	{
+		if(m_resultCache) m_resultCache->touch(]] .. self:getTableIndex(name) .. [[);
+	}
+
+	void invalidate]] .. name .. [[(unsigned long long id)
+	{
+		if(m_]] .. name .. [[Cache) m_]] .. name .. [[Cache->erase(id);
+		touch]] .. name .. [[();
+	}
+
+]])
+end
+
+function SQL:generateGetManyFunctions(file, name, tbl)
+	file:write([[
+	// Fetches all given ids using one statement per chunk of getBatchSize() ids and returns the ids
+	// which do not exist. Cached objects are not fetched again.
+	std::vector<unsigned long long> getMany]] .. name .. [[(const std::vector<unsigned long long>& ids, std::unordered_map<unsigned long long, ]] .. name .. [[>& out)
+	{
+		std::vector<unsigned long long> pending;
+		std::unordered_set<unsigned long long> seen, found; // out may already hold objects of earlier calls
+		for(auto id : ids)
+		{
+			if(!seen.insert(id).second) continue;
+
+			]] .. name .. [[ object;
+			if(m_]] .. name .. [[Cache && m_]] .. name .. [[Cache->get(id, object))
+			{
+				found.insert(id);
+				out[id] = std::move(object);
+			}
+			else
+				pending.push_back(id);
+		}
+
+		if(!pending.empty())
+		{
+			const size_t chunkSize = std::min(m_connection->getBatchSize(), pending.size());
+			const std::string source = "select * from `]] .. name .. [[` where id in (" + luasqlgen::makePlaceholders(chunkSize) + ");";
+			const bool cache = m_]] .. name .. [[Cache && !m_connection->getTransactionDepth();
+			std::vector<std::string> args(chunkSize);
+			luasqlgen::DatabaseResult result;
+
+			for(size_t offset = 0; offset < pending.size(); offset += chunkSize)
+			{
+				// The last chunk is padded by repeating its last id so all chunks share one statement
+				for(size_t i = 0; i < chunkSize; i++)
+					args[i] = std::to_string(pending[std::min(offset + i, pending.size() - 1)]);
+
+				result.clear();
+				m_connection->query(source, args, result);
+				for(auto& row : result)
+				{
+					]] .. name .. [[ object;
+]])
+	writeRowDecode(file, "\t\t\t\t\t", tbl)
+	file:write([[
+					if(cache) m_]] .. name .. [[Cache->put(object.id, object);
+					found.insert(object.id);
+					out[object.id] = std::move(object);
+				}
+			}
+		}
+
+		std::vector<unsigned long long> missing;
+		seen.clear();
+		for(auto id : ids)
+			if(seen.insert(id).second && !found.count(id))
+				missing.push_back(id);
+
+		return missing;
+	}
+
+	// Same as above, but returns the objects in the order of the ids. Missing ids are skipped.
+	std::vector<unsigned long long> getMany]] .. name .. [[(const std::vector<unsigned long long>& ids, std::vector<]] .. name .. [[>& out)
+	{
+		std::unordered_map<unsigned long long, ]] .. name .. [[> objects;
+		auto missing = getMany]] .. name .. [[(ids, objects);
+
+		out.reserve(out.size() + ids.size() - missing.size());
+		for(auto id : ids)
+		{
+			auto iter = objects.find(id);
+			if(iter != objects.end())
+				out.push_back(iter->second);
+		}
+
+		return missing;
+	}
+
+]])
 end
 
 function SQL:generateQueryFunction(file, name, tbl)
@@ -120,21 +469,18 @@ function SQL:generateQueryFunction(file, name, tbl)
 
 	file:write("\t\tfor(auto& row : result)\n\t\t{\n")
 	file:write("\t\t\t" .. name .. " object;\n");
-	file:write("\t\t\tobject.id = std::stoll(row[\"id\"]);\n")
-
-	for p,q in orderedPairs(tbl) do
-		if q == "string" then
-			file:write("\t\t\tobject." .. p .. " = std::move(row[\"" .. p .. "\"]);\n")
-		else
-			file:write("\t\t\tobject." .. p .. " = std::stoll(row[\"" .. p .. "\"]);\n")
-		end
-	end
+	writeRowDecode(file, "\t\t\t", tbl)
 	file:write("\t\t\tout.push_back(object);\n")
 	file:write("\t\t}\n")
 	file:write("\t}\n\n")
 end
 
 function SQL:generateSearchFunction(file, name, tbl)
+   local searchFields = self:getSearchFields(name, tbl)
+   if searchFields then
+      self:generateFullTextSearchFunction(file, name, tbl, searchFields)
+      return
+   end
 
    file:write("\tvoid search" .. name .. "(std::vector<" .. name .. ">& out, const std::string& term)\n\t{\n")
    file:write([[
@@ -159,20 +505,556 @@ function SQL:generateSearchFunction(file, name, tbl)
 
 	file:write("\t\tfor(auto& row : result)\n\t\t{\n")
 	file:write("\t\t\t" .. name .. " object;\n");
-	file:write("\t\t\tobject.id = std::stoll(row[\"id\"]);\n")
+	writeRowDecode(file, "\t\t\t", tbl)
+	file:write("\t\t\tout.push_back(object);\n")
+	file:write("\t\t}\n")
+	file:write("\t}\n\n")
+end
+
+function SQL:generateFindFunctions(file, name, tbl)
+	file:write("\t// Returns all rows matching the predicate. Every combination of conditions uses its own cached statement.\n")
+	file:write("\tvoid find" .. name .. "(std::vector<" .. name .. ">& out, const " .. name .. "Predicate& where)\n\t{\n")
+	file:write("\t\tluasqlgen::DatabaseResult result;\n")
+	file:write("\t\tm_connection->query(\"select * from `" .. name .. "`\" + where.where() + \";\", where.getArgs(), result);\n")
+	file:write("\t\tfor(auto& row : result)\n\t\t{\n")
+	file:write("\t\t\t" .. name .. " object;\n")
+	writeRowDecode(file, "\t\t\t", tbl)
+	file:write("\t\t\tout.push_back(std::move(object));\n")
+	file:write("\t\t}\n\t}\n\n")
+
+	local generated = {}
+	for i, index in ipairs(self:getIndexes(name, tbl)) do
+		-- Partial indexes only cover some rows, lookups would not match the whole table
+		local functionName = "find" .. name .. "By" .. table.concat(index.fields, "And")
+		if not index.where and not generated[functionName] then
+			generated[functionName] = true
+
+			local params = ""
+			local conditions = ""
+			local args = ""
+			for j, field in ipairs(index.fields) do
+				local paramType = cppType(tbl[field])
+				if paramType == "string" then
+					paramType = "const std::string&"
+				elseif paramType == "blob" then
+					paramType = "const blob&"
+				end
+
+				params = params .. paramType .. " " .. field .. ", "
+				conditions = conditions .. "`" .. field .. "` = ? and "
+				args = args .. field .. ", "
+			end
+
+			local source = "select * from `" .. name .. "` where " .. conditions:sub(1, -6) .. ";"
+			args = args:sub(1, -3)
+
+			if index.unique then
+				file:write("\t// Lookup using the unique index " .. index.name .. "\n")
+				file:write("\tbool " .. functionName .. "(" .. params .. name .. "& object)\n\t{\n")
+				file:write("\t\tluasqlgen::DatabaseResult result;\n")
+				file:write("\t\tm_connection->persistent().queryRef(\"" .. source .. "\", {" .. args .. "}, result);\n")
+				file:write("\t\tif(result.empty()) return false;\n\n")
+				file:write("\t\tauto& row = result[0];\n")
+				writeRowDecode(file, "\t\t", tbl)
+				file:write("\t\tobject.dirtyFields = 0;\n")
+				file:write("\t\treturn true;\n\t}\n\n")
+			else
+				file:write("\t// Lookup using the index " .. index.name .. "\n")
+				file:write("\tvoid " .. functionName .. "(std::vector<" .. name .. ">& out, " .. params:sub(1, -3) .. ")\n\t{\n")
+				file:write("\t\tluasqlgen::DatabaseResult result;\n")
+				file:write("\t\tm_connection->persistent().queryRef(\"" .. source .. "\", {" .. args .. "}, result);\n")
+				file:write("\t\tfor(auto& row : result)\n\t\t{\n")
+				file:write("\t\t\t" .. name .. " object;\n")
+				writeRowDecode(file, "\t\t\t", tbl)
+				file:write("\t\t\tout.push_back(std::move(object));\n")
+				file:write("\t\t}\n\t}\n\n")
+			end
+		end
+	end
+end
+
+-- Writes the body of a keyset paginated query, indented by one more level if nested is set.
+-- conditions and args are C++ expressions initializing the condition (without "where") and its arguments.
+local function writePageQuery(file, name, tbl, nested, select, conditions, args)
+	local id = "`" .. name .. "`.`id`"
+	local buffer = {}
+	local out = { write = function(self, text) buffer[#buffer + 1] = text end }
+
+	out:write([[
+		if(limit == 0)
+			throw std::invalid_argument("The page size has to be at least one row!");
+
+		std::string conditions = ]] .. conditions .. [[;
+		std::vector<std::string> args = ]] .. args .. [[;
+		if(after)
+		{
+			if(!conditions.empty()) conditions += " and ";
+			conditions += order == luasqlgen::ASCENDING ? "]] .. id .. [[ > ?" : "]] .. id .. [[ < ?";
+			args.push_back(std::to_string(after));
+		}
+
+		// One additional row tells whether there is another page. The limit is bound, so all page sizes share a statement.
+		luasqlgen::ArgViews views(args.begin(), args.end());
+		views.push_back(limit + 1);
+
+		luasqlgen::DatabaseResult result;
+		m_connection->queryRef("]] .. select .. [[" + (conditions.empty() ? std::string() : " where " + conditions)
+			+ (order == luasqlgen::ASCENDING ? " order by ]] .. id .. [[ asc" : " order by ]] .. id .. [[ desc")
+			+ " limit ?;", views, result);
 
+		const bool more = result.size() > limit;
+		if(more) result.pop_back();
+
+		unsigned long long cursor = 0;
+		for(auto& row : result)
+		{
+			]] .. name .. [[ object;
+]])
+	writeRowDecode(out, "\t\t\t", tbl)
+	out:write([[
+			cursor = object.id;
+			out.push_back(std::move(object));
+		}
+
+		return more ? cursor : 0;
+]])
+
+	local text = table.concat(buffer)
+	if nested then
+		text = text:gsub("([^\n]+)", "\t%1")
+	end
+	file:write(text)
+end
+
+function SQL:generateProjectionFunctions(file, name, tbl)
+	if next(tbl) == nil then
+		return
+	end
+
+	file:write("\t// Column list for a mask of " .. name .. "::<field>Field values, the id is always included\n")
+	file:write("\tstatic std::string " .. name .. "Columns(uint64_t fields)\n\t{\n")
+	file:write("\t\tstd::string columns = \"`id`\";\n")
 	for p,q in orderedPairs(tbl) do
-		if q == "string" then
-			file:write("\t\t\tobject." .. p .. " = std::move(row[\"" .. p .. "\"]);\n")
-		else
-			file:write("\t\t\tobject." .. p .. " = std::stoll(row[\"" .. p .. "\"]);\n")
+		file:write("\t\tif(fields & " .. name .. "::" .. p .. "Field) columns += \", `" .. p .. "`\";\n")
+	end
+	file:write("\t\treturn columns;\n\t}\n\n")
+
+	file:write([[
+	// Like get]] .. name .. [[ and find]] .. name .. [[, but only reads the columns selected by fields (a mask of
+	// ]] .. name .. [[::<field>Field values). Other fields are not assigned. Every mask uses its own
+	// cached statement.
+	bool get]] .. name .. [[Fields(unsigned long long id, uint64_t fields, ]] .. name .. [[& object)
+	{
+		luasqlgen::DatabaseResult result;
+		m_connection->query("select " + ]] .. name .. [[Columns(fields) + " from `]] .. name .. [[` where id = ?;", {std::to_string(id)}, result);
+		if(result.empty()) return false;
+
+		auto& row = result[0];
+		object.dirtyFields = 0;
+]])
+	writeRowDecode(file, "\t\t", tbl, name)
+	file:write([[
+		return true;
+	}
+
+	void find]] .. name .. [[Fields(std::vector<]] .. name .. [[>& out, uint64_t fields, const ]] .. name .. [[Predicate& where = ]] .. name .. [[Predicate())
+	{
+		luasqlgen::DatabaseResult result;
+		m_connection->query("select " + ]] .. name .. [[Columns(fields) + " from `]] .. name .. [[`" + where.where() + ";", where.getArgs(), result);
+
+		out.reserve(out.size() + result.size());
+		for(auto& row : result)
+		{
+			]] .. name .. [[ object;
+]])
+	writeRowDecode(file, "\t\t\t", tbl, name)
+	file:write([[
+			out.push_back(std::move(object));
+		}
+	}
+
+]])
+end
+
+-- Result type and conversion of sum() for numeric field types
+local aggregateTypes = {
+	int = { "int64_t", "std::stoll" },
+	int64 = { "int64_t", "std::stoll" },
+	uint = { "uint64_t", "std::stoull" },
+	uint64 = { "uint64_t", "std::stoull" },
+	float = { "double", "std::stod" },
+	double = { "double", "std::stod" }
+}
+
+function SQL:generateAggregateFunctions(file, name, tbl)
+	local predicate = "const " .. name .. "Predicate& where = " .. name .. "Predicate()"
+
+	file:write([[
+	// Aggregates are computed by the database, only a single value is transferred.
+	unsigned long long count]] .. name .. [[(]] .. predicate .. [[)
+	{
+		std::string value;
+		m_connection->queryScalar("select count(*) from `]] .. name .. [[`" + where.where() + ";", where.getArgs(), value);
+		return std::stoull(value);
+	}
+
+	bool exists]] .. name .. [[(]] .. predicate .. [[)
+	{
+		std::string value;
+		return m_connection->queryScalar("select 1 from `]] .. name .. [[`" + where.where() + " limit 1;", where.getArgs(), value);
+	}
+
+]])
+
+	for p,q in orderedPairs(tbl) do
+		local aggregate = aggregateTypes[q]
+		if aggregate then
+			local sumType, convert = aggregate[1], aggregate[2]
+			file:write([[
+	// Sum of all matching values, 0 if no row matches
+	]] .. sumType .. [[ sum]] .. name .. p .. [[(]] .. predicate .. [[)
+	{
+		std::string value;
+		if(!m_connection->queryScalar("select sum(`]] .. p .. [[`) from `]] .. name .. [[`" + where.where() + ";", where.getArgs(), value))
+			return 0;
+		return ]] .. convert .. [[(value);
+	}
+
+]])
+			for _, op in ipairs({ "min", "max" }) do
+				file:write([[
+	std::optional<]] .. q .. [[> ]] .. op .. name .. p .. [[(]] .. predicate .. [[)
+	{
+		std::string value;
+		if(!m_connection->queryScalar("select ]] .. op .. [[(`]] .. p .. [[`) from `]] .. name .. [[`" + where.where() + ";", where.getArgs(), value))
+			return std::nullopt;
+		return static_cast<]] .. q .. [[>(]] .. convert .. [[(value));
+	}
+
+]])
+			end
 		end
 	end
-	file:write("\t\t\tout.push_back(object);\n")
-	file:write("\t\t}\n")
+end
+
+function SQL:generateEagerLoadFunctions(file, name, tbl)
+	local tables = self.description.tables
+	for p,q in orderedPairs(tbl) do
+		if tables[q] ~= nil and p ~= q then
+			local companion = name .. "With" .. p
+			file:write([[
+	// Returns all rows matching the predicate together with the ]] .. q .. [[ rows referenced by ]] .. p .. [[.
+	// Needs two queries in total: one for the rows and one batched getMany]] .. q .. [[ for the references.
+	void load]] .. companion .. [[(std::vector<]] .. companion .. [[>& out, const ]] .. name .. [[Predicate& where = ]] .. name .. [[Predicate())
+	{
+		std::vector<]] .. name .. [[> objects;
+		find]] .. name .. [[(objects, where);
+
+		std::vector<unsigned long long> ids;
+		ids.reserve(objects.size());
+		for(auto& object : objects)
+			ids.push_back(object.]] .. p .. [[);
+
+		std::unordered_map<unsigned long long, ]] .. q .. [[> references;
+		getMany]] .. q .. [[(ids, references);
+
+		out.reserve(out.size() + objects.size());
+		for(auto& object : objects)
+		{
+			]] .. companion .. [[ entry;
+			auto iter = references.find(object.]] .. p .. [[);
+			if(iter != references.end())
+			{
+				entry.]] .. p .. [[ = iter->second;
+				entry.]] .. p .. [[Found = true;
+			}
+
+			entry.object = std::move(object);
+			out.push_back(std::move(entry));
+		}
+	}
+
+]])
+		end
+	end
+end
+
+function SQL:generatePageFunctions(file, name, tbl)
+	local pageParams = "size_t limit, unsigned long long after = 0, luasqlgen::ORDER order = luasqlgen::ASCENDING"
+
+	file:write("\t// Paginated variants of find, query and search. They return at most limit rows ordered by id, starting after\n")
+	file:write("\t// the id given as cursor (0 for the first page), and return the cursor of the next page or 0 after the last one.\n")
+	file:write("\tunsigned long long find" .. name .. "Page(std::vector<" .. name .. ">& out, const " .. name .. "Predicate& where, " .. pageParams .. ")\n\t{\n")
+	writePageQuery(file, name, tbl, false, "select * from `" .. name .. "`", "where.getSql()", "where.getArgs()")
+	file:write("\t}\n\n")
+
+	local params = ""
+	local conditions = ""
+	local args = ""
+	local likeConditions = ""
+	local likeArgs = ""
+	for p,q in orderedPairs(tbl) do
+		params = params .. "const std::string& " .. p .. ", "
+		conditions = conditions .. "`" .. p .. "` like ? and "
+		args = args .. p .. ", "
+		likeConditions = likeConditions .. "`" .. p .. "` like ? or "
+		likeArgs = likeArgs .. "processedTerm, "
+	end
+
+	if params == "" then
+		return
+	end
+
+	file:write("\tunsigned long long query" .. name .. "Page(std::vector<" .. name .. ">& out, " .. params .. pageParams .. ")\n\t{\n")
+	writePageQuery(file, name, tbl, false, "select * from `" .. name .. "`", "\"" .. conditions:sub(1, -6) .. "\"", "{" .. args:sub(1, -3) .. "}")
+	file:write("\t}\n\n")
+
+	file:write("\tunsigned long long search" .. name .. "Page(std::vector<" .. name .. ">& out, const std::string& term, " .. pageParams .. ")\n\t{\n")
+	local searchFields = self:getSearchFields(name, tbl)
+	if searchFields then
+		local fts = name .. "_fts"
+		file:write([[
+		if(!strcmp(m_connection->getName(), "MariaDB"))
+		{
+]])
+		writePageQuery(file, name, tbl, true, "select * from `" .. name .. "`",
+			"\"match(`" .. table.concat(searchFields, "`, `") .. "`) against (? in natural language mode)\"", "{term}")
+		file:write([[
+		}
+
+		const std::string query = luasqlgen::ftsQuery(term);
+		if(query.empty()) return 0;
+
+]])
+		writePageQuery(file, name, tbl, false, "select `" .. name .. "`.* from `" .. name .. "` join `" .. fts .. "` on `" .. fts .. "`.rowid = `" .. name .. "`.`id`",
+			"\"`" .. fts .. "` match ?\"", "{query}")
+	else
+		file:write([[
+		std::string processedTerm = "%" + term + "%";
+		std::replace(processedTerm.begin(), processedTerm.end(), ' ', '%');
+
+]])
+		writePageQuery(file, name, tbl, false, "select * from `" .. name .. "`", "\"(" .. likeConditions:sub(1, -5) .. ")\"", "{" .. likeArgs:sub(1, -3) .. "}")
+	end
 	file:write("\t}\n\n")
 end
 
+function SQL:generateFullTextSearchFunction(file, name, tbl, fields)
+	local columns = "`" .. table.concat(fields, "`, `") .. "`"
+
+	file:write([[
+	// Full text search using the FTS5 index on SQLite and the fulltext index on MariaDB.
+	// Returns at most limit results, the most relevant first.
+	void search]] .. name .. [[(std::vector<]] .. name .. [[>& out, const std::string& term, size_t limit = 100)
+	{
+		luasqlgen::DatabaseResult result;
+		if(!strcmp(m_connection->getName(), "MariaDB"))
+		{
+			m_connection->persistent().queryRef("select * from `]] .. name .. [[` where match(]] .. columns .. [[) against (? in natural language mode) limit ?;", {term, limit}, result);
+		}
+		else
+		{
+			const std::string query = luasqlgen::ftsQuery(term);
+			if(query.empty()) return;
+
+			m_connection->persistent().queryRef("select `]] .. name .. [[`.* from `]] .. name .. [[` join `]] .. name .. [[_fts` on `]] .. name .. [[_fts`.rowid = `]] .. name .. [[`.`id` "
+				"where `]] .. name .. [[_fts` match ? order by rank limit ?;", {query, limit}, result);
+		}
+
+		for(auto& row : result)
+		{
+			]] .. name .. [[ object;
+]])
+	writeRowDecode(file, "\t\t\t", tbl)
+	file:write([[
+			out.push_back(std::move(object));
+		}
+	}
+
+]])
+end
+
+function SQL:generateLoadCSVFunction(file, name, tbl)
+	local fieldCount = 0
+	local columnList = ""
+	for p,q in orderedPairs(tbl) do
+		columnList = columnList .. "`" .. p .. "`, "
+		fieldCount = fieldCount + 1
+	end
+
+	if fieldCount == 0 then
+		return
+	end
+	columnList = columnList:sub(1, -3)
+
+	file:write([[
+	// Loads a CSV/TSV file whose first line names the columns. Unknown columns are ignored and an "id"
+	// column keeps the ids from the file. The file is parsed on a separate thread while this thread
+	// inserts multi-row statements, one transaction per batch.
+	luasqlgen::LoadStats load]] .. name .. [[CSV(const std::string& path, char delimiter = ',')
+	{
+		luasqlgen::MappedFile file(path);
+		luasqlgen::CSVReader reader(file.data(), delimiter);
+
+		std::vector<std::string_view> header;
+		if(!reader.next(header)) return luasqlgen::LoadStats();
+
+		// Maps every column of the file to a field, -1 marks ignored columns
+		bool withId = false;
+		std::vector<int> columns;
+		for(auto& column : header)
+		{
+			if(column == "id") { columns.push_back(0); withId = true; }
+]])
+
+	local index = 1
+	for p,q in orderedPairs(tbl) do
+		file:write("\t\t\telse if(column == \"" .. p .. "\") columns.push_back(" .. index .. ");\n")
+		index = index + 1
+	end
+
+	file:write([[
+			else columns.push_back(-1);
+		}
+
+		const size_t fieldCount = ]] .. fieldCount .. [[ + withId;
+		const size_t rowsPerStmt = std::max<size_t>(1, m_connection->getBatchSize() / fieldCount);
+		const std::string columnList = std::string(withId ? "`id`, " : "") + "]] .. columnList .. [[";
+		const std::string batchSource = "insert into `]] .. name .. [[` (" + columnList + ") values " + luasqlgen::makeRowPlaceholders(fieldCount, rowsPerStmt) + ";";
+		const std::string rowSource = "insert into `]] .. name .. [[` (" + columnList + ") values " + luasqlgen::makeRowPlaceholders(fieldCount, 1) + ";";
+
+		// Arguments refer to the objects of the batch, which outlives the statements
+		luasqlgen::ArgViews args;
+		auto appendArgs = [&](const ]] .. name .. [[& object)
+		{
+			if(withId) args.push_back(object.id);
+]])
+
+	for p,q in orderedPairs(tbl) do
+		file:write("\t\t\targs.push_back(object." .. p .. ");\n")
+	end
+
+	file:write([[
+		};
+
+		return luasqlgen::loadParallel<]] .. name .. [[>(reader, rowsPerStmt * 16,
+			[&](const std::vector<std::string_view>& fields, ]] .. name .. [[& object)
+			{
+				const size_t count = std::min(fields.size(), columns.size());
+				for(size_t i = 0; i < count; i++)
+				{
+					switch(columns[i])
+					{
+						case 0: luasqlgen::parseField(fields[i], object.id); break;
+]])
+
+	index = 1
+	for p,q in orderedPairs(tbl) do
+		file:write("\t\t\t\t\t\tcase " .. index .. ": luasqlgen::parseField(fields[i], object." .. p .. "); break;\n")
+		index = index + 1
+	end
+
+	file:write([[
+					}
+				}
+				object.validate();
+			},
+			[&](std::vector<]] .. name .. [[>& batch)
+			{
+				luasqlgen::Transaction transaction(*m_connection);
+
+				size_t offset = 0;
+				for(; offset + rowsPerStmt <= batch.size(); offset += rowsPerStmt)
+				{
+					args.clear();
+					for(size_t i = offset; i < offset + rowsPerStmt; i++)
+						appendArgs(batch[i]);
+
+					m_connection->persistent().queryRef(batchSource, args);
+				}
+
+				// Rows which do not fill a whole statement are inserted one by one
+				for(; offset < batch.size(); offset++)
+				{
+					args.clear();
+					appendArgs(batch[offset]);
+					m_connection->persistent().queryRef(rowSource, args);
+				}
+
+				transaction.commit();
+				touch]] .. name .. [[();
+			});
+	}
+
+]])
+end
+
+function SQL:generateExportFunction(file, name, tbl)
+	local count = 1
+	file:write("\t// Streams the whole table to a file descriptor. Rows are read in pages of pageSize rows\n")
+	file:write("\t// using the last id as cursor, so memory use does not depend on the size of the table.\n")
+	file:write("\tsize_t export" .. name .. "(int fd, luasqlgen::EXPORT_FORMAT format = luasqlgen::EXPORT_CSV, size_t pageSize = 1000)\n\t{\n")
+	file:write("\t\tif(pageSize == 0)\n\t\t\tthrow std::invalid_argument(\"The page size has to be at least one row!\");\n\n")
+	file:write("\t\tstatic const luasqlgen::ExportColumn columns[] = {{\"id\", false}")
+	for p,q in orderedPairs(tbl) do
+		file:write(", {\"" .. p .. "\", " .. tostring(q == "string" or q == "blob") .. ", " .. tostring(q == "blob") .. "}")
+		count = count + 1
+	end
+	file:write("};\n\n")
+
+	file:write([[
+		luasqlgen::TableExporter exporter(fd, format, columns, ]] .. count .. [[);
+		exporter.writeHeader();
+
+		const std::string source = "select * from `]] .. name .. [[` where id > ? order by id limit ?;";
+		unsigned long long lastId = 0;
+		size_t rows = 0;
+
+		luasqlgen::DatabaseResult result;
+		while(true)
+		{
+			result.clear();
+			m_connection->queryRef(source, {lastId, pageSize}, result);
+			for(auto& row : result)
+				exporter.writeRow(row);
+
+			rows += result.size();
+			if(result.size() < pageSize)
+				break;
+
+			lastId = std::stoull(result.back()["id"]);
+		}
+
+		exporter.finish();
+		return rows;
+	}
+
+]])
+end
+
+function SQL:generateBlobFunctions(file, name, tbl)
+	for p,q in orderedPairs(tbl) do
+		if q == "blob" then
+			file:write([[
+	// Streams ]] .. p .. [[ of one row in chunks instead of loading it as a whole, returns the number of bytes written to out
+	size_t read]] .. name .. p .. [[(unsigned long long id, std::ostream& out, size_t chunkSize = 1 << 20)
+	{
+		return m_connection->readBlob("]] .. name .. [[", "]] .. p .. [[", id, out, chunkSize);
+	}
+
+	// Replaces ]] .. p .. [[ of one row with size bytes read from in. Only SQLite writes it in place chunk by chunk,
+	// other backends hold the whole value in memory and send it with a single update.
+	void write]] .. name .. p .. [[(unsigned long long id, std::istream& in, size_t size, size_t chunkSize = 1 << 20)
+	{
+		m_connection->writeBlob("]] .. name .. [[", "]] .. p .. [[", id, in, size, chunkSize);
+		invalidate]] .. name .. [[(id);
+	}
+
+]])
+		end
+	end
+end
+
 function SQL:generateCreateStmt(file, name, tbl)
    -- print("Generating create" .. name .. "Stmt")
 
@@ -238,7 +1120,8 @@ local mysqltypes = {
 	int64 = "bigint",
 	uint64 = "bigint unsigned",
 	bool = "bool", -- FIXME: Byte?
-	double = "double"
+	double = "double",
+	blob = "longblob"
 }
 
 local function type2mysql(type)
@@ -264,8 +1147,17 @@ function SQL:generateInstallStmtMariaDB(tables, constraints)
 			 end
 		end
 
+		local searchFields = self:getSearchFields(k, v)
+		if searchFields then
+			stmt = stmt .. generateSearchIndexMariaDB(k, searchFields)
+		end
+
 		stmt = stmt .. ");\n\n"
 		result = result .. "m_connection->query(\"" .. stmt:escape() .. "\");\n"
+
+		for i, index in ipairs(self:getIndexes(k, v)) do
+			result = result .. "m_connection->query(\"" .. generateIndexMariaDB(k, v, index):escape() .. "\");\n"
+		end
 	end
 	return result
 end
@@ -277,7 +1169,8 @@ local sqlitetypes = {
 	int64 = "int",
 	uint64 = "int",
 	bool = "int", -- FIXME: Byte?
-	double = "double"
+	double = "double",
+	blob = "blob"
 }
 
 local function type2sqlite(type)
@@ -305,6 +1198,16 @@ function SQL:generateInstallStmtSQLite(tables, constraints)
 		end
 
 		stmt = stmt .. ");\n\n"
+
+		for i, index in ipairs(self:getIndexes(k, v)) do
+			stmt = stmt .. generateIndexSQLite(k, index)
+		end
+
+		local searchFields = self:getSearchFields(k, v)
+		if searchFields then
+			stmt = stmt .. generateSearchIndexSQLite(k, searchFields)
+		end
+
 		result = result .. "m_connection->query(\"" .. stmt:escape() .. "\");\n"
 	end
 	return result
@@ -332,6 +1235,20 @@ function SQL:generateInstallScriptSQLite(description)
 		end
 
 		result = result .. ");\n\n"
+
+		local indexes = self:getIndexes(k, v)
+		for i, index in ipairs(indexes) do
+			result = result .. generateIndexSQLite(k, index)
+		end
+
+		if #indexes > 0 then
+			result = result .. "\n"
+		end
+
+		local searchFields = self:getSearchFields(k, v)
+		if searchFields then
+			result = result .. generateSearchIndexSQLite(k, searchFields)
+		end
 	end
 	return result
 end
@@ -357,7 +1274,21 @@ function SQL:generateInstallScriptMariaDB(description)
 			end
 		end
 
+		local searchFields = self:getSearchFields(k, v)
+		if searchFields then
+			result = result .. generateSearchIndexMariaDB(k, searchFields)
+		end
+
 		result = result .. ");\n\n"
+
+		local indexes = self:getIndexes(k, v)
+		for i, index in ipairs(indexes) do
+			result = result .. generateIndexMariaDB(k, v, index)
+		end
+
+		if #indexes > 0 then
+			result = result .. "\n"
+		end
 	end
 	return result
 end
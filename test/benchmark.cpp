@@ -0,0 +1,125 @@
+#include "../cpp/SQLiteConnection.h"
+#include "test.h"
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+
+using namespace luasqlgen;
+
+namespace
+{
+class Timer
+{
+	std::chrono::steady_clock::time_point m_start = std::chrono::steady_clock::now();
+
+public:
+	double rate(size_t operations) const
+	{
+		const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - m_start).count();
+		return seconds > 0.0 ? operations / seconds : 0.0;
+	}
+};
+
+void removeDatabase()
+{
+	std::remove("benchmark.db");
+	std::remove("benchmark.db-wal");
+	std::remove("benchmark.db-shm");
+}
+}
+
+// Runs the generated CRUD functions against a file database with every tuning profile
+// and prints the throughput of each phase together with the settings SQLite applied.
+int main(int argc, char** argv)
+{
+	const size_t rows = argc > 1 ? std::stoul(argv[1]) : 20000;
+	const size_t batchSize = 1000;
+
+	for(auto profile : {PROFILE_DEFAULT, PROFILE_READ_HEAVY, PROFILE_INGEST, PROFILE_LOW_MEMORY})
+	{
+		removeDatabase();
+
+		auto connection = std::make_shared<SQLiteConnection>();
+		connection->connect("benchmark", profile);
+
+		test::test db(connection);
+		db.install();
+
+		std::vector<test::table> objects(rows);
+		Timer insert;
+		for(size_t offset = 0; offset < rows; offset += batchSize)
+		{
+			auto transaction = db.transaction();
+			for(size_t i = offset; i < std::min(offset + batchSize, rows); i++)
+			{
+				objects[i].field1 = "name " + std::to_string(i);
+				objects[i].field2 = std::string(64, 'x');
+				objects[i].field3 = std::to_string(i % 100);
+				db.create(objects[i]);
+			}
+			transaction.commit();
+		}
+		const double insertRate = insert.rate(rows);
+
+		Timer read;
+		test::table object;
+		for(auto& o : objects)
+			db.get(o.id, object);
+		const double readRate = read.rate(rows);
+
+		Timer update;
+		for(size_t offset = 0; offset < rows; offset += batchSize)
+		{
+			auto transaction = db.transaction();
+			for(size_t i = offset; i < std::min(offset + batchSize, rows); i++)
+			{
+				objects[i].field3 = "updated";
+				db.update(objects[i]);
+			}
+			transaction.commit();
+		}
+		const double updateRate = update.rate(rows);
+
+		Timer remove;
+		for(size_t offset = 0; offset < rows; offset += batchSize)
+		{
+			auto transaction = db.transaction();
+			for(size_t i = offset; i < std::min(offset + batchSize, rows); i++)
+				db.remove(objects[i]);
+			transaction.commit();
+		}
+		const double removeRate = remove.rate(rows);
+
+		const SQLiteStatus status = connection->getStatus();
+		std::cout << getSQLiteProfile(profile).name << ":\n"
+			<< "\tinsert " << insertRate << " rows/s, get " << readRate << " rows/s, update "
+			<< updateRate << " rows/s, delete " << removeRate << " rows/s\n"
+			<< "\tjournal_mode=" << status.journalMode << " synchronous=" << status.synchronous
+			<< " mmap_size=" << status.mmapSize << " cache_size=" << status.cacheSize
+			<< " temp_store=" << status.tempStore << " wal_autocheckpoint=" << status.walAutocheckpoint
+			<< " page_size=" << status.pageSize << "\n"
+			<< "\tcache used " << status.cacheUsed << " bytes, " << status.cacheHit << " hits, "
+			<< status.cacheMiss << " misses, " << status.cacheWrite << " writes" << std::endl;
+
+		connection->close();
+	}
+
+	// Mutex overhead saved by connections only ever used from one thread
+	for(auto threading : {THREADING_MULTI, THREADING_SERIALIZED})
+	{
+		SQLiteConnection connection;
+		connection.setThreading(threading);
+		connection.connect(":memory:");
+
+		std::string value;
+		Timer query;
+		for(size_t i = 0; i < rows; i++)
+			connection.queryScalar("select ?", {"1"}, value);
+
+		std::cout << (threading == THREADING_MULTI ? "multi thread" : "serialized") << ": "
+			<< query.rate(rows) << " queries/s" << std::endl;
+	}
+
+	removeDatabase();
+	return 0;
+}
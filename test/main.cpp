@@ -1,5 +1,12 @@
 #include "../cpp/MariaDBConnection.h"
 #include "../cpp/SQLiteConnection.h"
+#include "../cpp/Transaction.h"
+#include "../cpp/CSVLoader.h"
+#include "../cpp/Predicate.h"
+#include "../cpp/ObjectCache.h"
+#include "../cpp/ResultCache.h"
+#include "../cpp/WALCheckpointer.h"
+#include "test.h"
 #include <gtest/gtest.h>
 
 using namespace luasqlgen;
@@ -28,6 +35,759 @@ TEST(SQLite, AdHocQueries)
 	EXPECT_NO_THROW(c.query("drop table Test"));
 }
 
+TEST(SQLite, CachedQuery)
+{
+	SQLiteConnection c;
+	c.connect(":memory:");
+
+	// Later statements depend on earlier ones of the same string
+	c.query("create table Test (test int); insert into Test (test) values (1); -- comment\n");
+
+	const std::string insert = "insert into Test (test) values (2);\n insert into Test (test) values (3)";
+	c.query(insert);
+	c.query(insert);
+
+	std::string value;
+	c.queryScalar("select sum(test) from Test", {}, value);
+	EXPECT_EQ("11", value);
+
+	EXPECT_THROW(c.query("insert into Test (test) values (4); insert into Missing values (5);"), std::runtime_error);
+	EXPECT_THROW(c.query("insert into Test (test) values (4); insert into Missing values (5);"), std::runtime_error);
+
+	// Only the most recently used script stays prepared
+	c.setScriptCacheSize(1);
+	c.query("delete from Test where test = 1");
+	c.query("delete from Test where test = 2");
+
+	auto status = c.getStatementStatus();
+	EXPECT_EQ(0, status.count("delete from Test where test = 1"));
+	EXPECT_EQ(1, status.count("delete from Test where test = 2"));
+}
+
+TEST(SQLite, QueryRef)
+{
+	SQLiteConnection c;
+	c.connect(":memory:");
+	c.query("create table Test (name text, data blob, number int, real double)");
+
+	const char buffer[] = "name and more";
+	const char bytes[] = {1, 0, 2};
+	c.queryRef("insert into Test (name, data, number, real) values (?, ?, ?, ?)",
+		{std::string_view(buffer, 4), ArgView::blob(bytes, sizeof(bytes)), 42, 0.5});
+
+	DatabaseResult result;
+	c.queryRef("select name, length(data) as size, typeof(number) as type, real from Test where number = ?", {42ull}, result);
+	ASSERT_EQ(1, result.size());
+	EXPECT_EQ("name", result[0]["name"]);
+	EXPECT_EQ("3", result[0]["size"]);
+	EXPECT_EQ("integer", result[0]["type"]);
+	EXPECT_EQ("0.5", result[0]["real"]);
+
+	// Backends binding strings get numbers which read back to the same value
+	EXPECT_EQ(0.1, std::stod(ArgView(0.1).toString()));
+	EXPECT_EQ(1e-7, std::stod(ArgView(1e-7).toString()));
+	EXPECT_EQ(1.0f / 3, std::stof(realToString(1.0f / 3)));
+
+	// Bindings are cleared after every call and do not leak into the next one
+	std::string value;
+	EXPECT_TRUE(c.queryScalar("select ?", {"first"}, value));
+	EXPECT_FALSE(c.queryScalar("select ?", {}, value));
+
+	// Only the most recently used statements stay prepared
+	c.setStatementCacheSize(1);
+	c.queryScalar("select ? + 1", {"1"}, value);
+	c.queryScalar("select ? + 2", {"1"}, value);
+	EXPECT_EQ("3", value);
+
+	auto status = c.getStatementStatus();
+	EXPECT_EQ(0, status.count("select ? + 1"));
+	EXPECT_EQ(1, status.count("select ? + 2"));
+}
+
+TEST(SQLite, Blob)
+{
+	SQLiteConnection c;
+	c.connect(":memory:");
+	c.query("create table Test (id integer primary key, data blob)");
+
+	const Blob bytes = {std::byte(1), std::byte(0), std::byte(2)};
+	c.queryRef("insert into Test (data) values (?)", {bytes});
+
+	// Embedded NULs survive the round trip
+	DatabaseResult result;
+	c.query("select data from Test", {}, result);
+	Blob value;
+	toBlob(result[0]["data"], value);
+	EXPECT_EQ(bytes, value);
+
+	std::string payload(10000, 'x');
+	for(size_t i = 0; i < payload.size(); i++)
+		payload[i] = char(i);
+
+	std::istringstream in(payload);
+	c.writeBlob("Test", "data", 1, in, payload.size(), 4096);
+
+	std::ostringstream out;
+	EXPECT_EQ(payload.size(), c.readBlob("Test", "data", 1, out, 1000));
+	EXPECT_EQ(payload, out.str());
+
+	// Writes can not grow a blob
+	auto blob = c.openBlob("Test", "data", 1, true);
+	EXPECT_EQ(payload.size(), blob->size());
+	EXPECT_THROW(blob->write("ab", 2, payload.size() - 1), std::runtime_error);
+
+	// The fallback of backends without incremental I/O
+	std::istringstream reversed(std::string(payload.rbegin(), payload.rend()));
+	c.DatabaseConnection::writeBlob("Test", "data", 1, reversed, payload.size(), 4096);
+
+	std::ostringstream generic;
+	EXPECT_EQ(payload.size(), c.DatabaseConnection::readBlob("Test", "data", 1, generic, 1000));
+	EXPECT_EQ(std::string(payload.rbegin(), payload.rend()), generic.str());
+}
+
+TEST(SQLite, Columns)
+{
+	SQLiteConnection c;
+	c.connect(":memory:");
+	c.query("create table Test (name TEXT, number INT)");
+	c.query("insert into Test (name, number) values ('a', 1)");
+
+	auto stmt = c.getCachedStmt("select name, number, number * 2 as twice from Test");
+	ASSERT_EQ(3, stmt->getColumnCount());
+	EXPECT_EQ("name", stmt->getColumns()[0].name);
+	EXPECT_EQ("TEXT", stmt->getColumns()[0].declType);
+	EXPECT_EQ("INT", stmt->getColumns()[1].declType);
+	EXPECT_EQ("twice", stmt->getColumns()[2].name);
+	EXPECT_EQ("", stmt->getColumns()[2].declType);
+
+	DatabaseResult result;
+	stmt->query({}, result);
+	ASSERT_EQ(1, result.size());
+	EXPECT_EQ("2", result[0]["twice"]);
+
+	// A cached "select *" picks up columns added later
+	auto all = c.getCachedStmt("select * from Test");
+	EXPECT_EQ(2, all->getColumnCount());
+	c.query("alter table Test add column extra TEXT default 'x'");
+
+	result.clear();
+	all->query({}, result);
+	ASSERT_EQ(1, result.size());
+	EXPECT_EQ("x", result[0]["extra"]);
+	EXPECT_EQ(3, all->getColumnCount());
+
+	// Resetting the counters does not hide later schema changes
+	c.getStatementStatus(true);
+	c.query("alter table Test rename column extra to renamed");
+
+	result.clear();
+	all->query({}, result);
+	ASSERT_EQ(1, result.size());
+	EXPECT_EQ("x", result[0]["renamed"]);
+}
+
+TEST(SQLite, StatementStatus)
+{
+	SQLiteConnection c;
+	c.connect(":memory:");
+	c.query("create table Test (test int, name text)");
+	c.query("create index TestName on Test (name)");
+	for(int i = 0; i < 10; i++)
+		c.queryJson("insert into Test (test, name) values (?, ?)", {std::to_string(i), std::to_string(i)});
+
+	const std::string scan = "select * from Test where test = ? order by name desc";
+	const std::string lookup = "select * from Test where name = ?";
+	c.queryJson(scan, {"5"});
+	c.queryJson(lookup, {"5"});
+
+	auto status = c.getStatementStatus(true);
+	EXPECT_GT(status[scan].fullscanSteps, 0);
+	EXPECT_EQ(0, status[lookup].fullscanSteps);
+	EXPECT_GT(status[lookup].vmSteps, 0);
+
+	// Counters were reset
+	EXPECT_EQ(0, c.getStatementStatus()[scan].fullscanSteps);
+}
+
+TEST(SQLite, QueryScalar)
+{
+	SQLiteConnection c;
+	c.connect(":memory:");
+	c.query("create table Test (test int)");
+	c.query("insert into Test (test) values (5), (7)");
+
+	std::string value;
+	EXPECT_TRUE(c.queryScalar("select sum(test) from Test where test > ?", {"0"}, value));
+	EXPECT_EQ("12", value);
+	EXPECT_FALSE(c.queryScalar("select sum(test) from Test where test > ?", {"10"}, value));
+	EXPECT_FALSE(c.queryScalar("select test from Test where test > ?", {"10"}, value));
+}
+
+TEST(SQLite, Profile)
+{
+	SQLiteConnection c;
+	c.connect(":memory:", PROFILE_LOW_MEMORY);
+
+	const SQLiteStatus status = c.getStatus();
+	EXPECT_EQ(-512, status.cacheSize);
+	EXPECT_EQ(1, status.synchronous);
+	EXPECT_EQ(1, status.tempStore);
+	EXPECT_GT(status.cacheUsed, 0);
+}
+
+TEST(SQLite, WALCheckpointer)
+{
+	std::remove("checkpoint.db");
+	SQLiteConnection c;
+	c.connect("checkpoint");
+	c.query("create table Test (test int)");
+
+	CheckpointOptions options;
+	options.pollInterval = std::chrono::milliseconds(5);
+	options.walSizeLimit = 1;
+	c.setAutoCheckpoint(500);
+	{
+		WALCheckpointer checkpointer(c, options);
+		EXPECT_EQ(0, c.getAutoCheckpoint());
+
+		for(int i = 0; i < 100; i++)
+			c.queryJson("insert into Test (test) values (?)", {std::to_string(i)});
+
+		// The pending frames start a checkpoint in the background
+		for(int i = 0; i < 200 && !checkpointer.getMetrics().passive; i++)
+			std::this_thread::sleep_for(std::chrono::milliseconds(5));
+		ASSERT_GT(checkpointer.getMetrics().passive, 0);
+
+		// Once everything was written back, the WAL file keeps its size but no more checkpoints run
+		std::this_thread::sleep_for(std::chrono::milliseconds(20));
+		const unsigned long long idle = checkpointer.getMetrics().passive;
+		std::this_thread::sleep_for(std::chrono::milliseconds(50));
+		EXPECT_EQ(idle, checkpointer.getMetrics().passive);
+		EXPECT_GT(checkpointer.getWalSize(), 0);
+
+		// Writes the WAL back and resets it to zero bytes
+		EXPECT_TRUE(checkpointer.checkpointNow(CHECKPOINT_TRUNCATE));
+		EXPECT_EQ(0, checkpointer.getWalSize());
+
+		const CheckpointMetrics metrics = checkpointer.getMetrics();
+		EXPECT_EQ(1, metrics.truncate);
+		EXPECT_GT(metrics.walSize, 0);
+		EXPECT_GE(metrics.maxDuration, metrics.lastDuration);
+		EXPECT_EQ(0, metrics.errors);
+	}
+
+	// The previous setting is restored, not the SQLite default
+	EXPECT_EQ(500, c.getAutoCheckpoint());
+
+	c.close();
+	std::remove("checkpoint.db");
+	std::remove("checkpoint.db-wal");
+	std::remove("checkpoint.db-shm");
+}
+
+TEST(SQLite, Backup)
+{
+	std::remove("backup.db");
+	std::remove("snapshot.db");
+
+	SQLiteConnection c;
+	c.connect("backup");
+	c.query("create table Test (test int)");
+	for(int i = 0; i < 1000; i++)
+		c.queryJson("insert into Test (test) values (?)", {std::string(100, 'x')});
+
+	// Small steps, the connection stays usable in between
+	const BackupStats stats = c.backup("snapshot.db", 2);
+	EXPECT_GT(stats.pages, 2);
+	EXPECT_GE(stats.steps, stats.pages / 2);
+
+	SQLiteConnection memory;
+	memory.connect(":memory:");
+	const BackupStats loaded = memory.load("snapshot.db");
+	EXPECT_EQ(stats.pages, loaded.pages);
+
+	std::string value;
+	EXPECT_TRUE(memory.queryScalar("select count(*) from Test", {}, value));
+	EXPECT_EQ("1000", value);
+
+	EXPECT_THROW(memory.load("missing/snapshot.db"), std::runtime_error);
+
+	// Gives up once the target stays locked for longer than the busy timeout
+	SQLiteConnection locked;
+	locked.connect("snapshot");
+	locked.query("begin exclusive");
+	c.setBusyTimeout(10);
+	EXPECT_THROW(c.backup("snapshot.db"), BusyError);
+	locked.query("rollback");
+	locked.close();
+
+	c.close();
+	std::remove("backup.db");
+	std::remove("snapshot.db");
+}
+
+TEST(SQLite, Threading)
+{
+	SQLiteConnection multi, serialized;
+	multi.setThreading(THREADING_MULTI);
+	serialized.setThreading(THREADING_SERIALIZED);
+	multi.connect(":memory:");
+	serialized.connect(":memory:");
+
+	EXPECT_FALSE(multi.isSerialized());
+	EXPECT_EQ(sqlite3_threadsafe() != 0, serialized.isSerialized());
+
+	// SQLite was initialized by connect, the process wide mode can not change anymore
+	EXPECT_THROW(SQLiteConnection::configureThreading(THREADING_SINGLE), std::runtime_error);
+}
+
+TEST(SQLite, NestedTransaction)
+{
+	SQLiteConnection c;
+	c.connect(":memory:");
+	c.query("create table Test (test int)");
+
+	{
+		Transaction outer(c, IMMEDIATE);
+		c.query("insert into Test (test) values (1)");
+		{
+			Transaction inner(c);
+			EXPECT_TRUE(inner.isNested());
+			c.query("insert into Test (test) values (2)");
+			// Left without commit, only the savepoint is rolled back
+		}
+
+		try
+		{
+			Transaction inner(c);
+			c.query("insert into Test (test) values (3)");
+			throw std::runtime_error("Unwind");
+		}
+		catch(const std::runtime_error&) {}
+
+		outer.commit();
+	}
+
+	EXPECT_EQ(0, c.getTransactionDepth());
+
+	DatabaseResult result;
+	c.query("select test from Test", {}, result);
+	ASSERT_EQ(1, result.size());
+	EXPECT_EQ("1", result[0]["test"]);
+}
+
+TEST(SQLite, TransactionRetry)
+{
+	SQLiteConnection a, b;
+	a.connect("SQLiteRetryTest");
+	b.connect("SQLiteRetryTest");
+	b.setBusyTimeout(0);
+
+	a.query("create table if not exists Test (test int)");
+
+	TransactionRetry retry;
+	retry.maxAttempts = 3;
+	{
+		Transaction lock(a, EXCLUSIVE);
+		EXPECT_THROW(retry.run(b, [&]{ b.query("insert into Test (test) values (1)"); }), BusyError);
+	}
+
+	EXPECT_EQ(2, retry.getStats().retries);
+	EXPECT_EQ(1, retry.getStats().failures);
+
+	EXPECT_NO_THROW(retry.run(b, [&]{ b.query("insert into Test (test) values (1)"); }));
+	EXPECT_EQ(1, retry.getStats().commits);
+
+	a.query("drop table Test");
+}
+
+TEST(CSV, Reader)
+{
+	CSVReader reader("a,\"b,\"\"c\"\"\",,d\r\n\n1\t2\n\"multi\nline\"", ',');
+	std::vector<std::string_view> fields;
+
+	ASSERT_TRUE(reader.next(fields));
+	ASSERT_EQ(4, fields.size());
+	EXPECT_EQ("a", fields[0]);
+	EXPECT_EQ("b,\"c\"", fields[1]);
+	EXPECT_EQ("", fields[2]);
+	EXPECT_EQ("d", fields[3]);
+
+	ASSERT_TRUE(reader.next(fields));
+	ASSERT_EQ(1, fields.size());
+	EXPECT_EQ("1\t2", fields[0]);
+
+	ASSERT_TRUE(reader.next(fields));
+	EXPECT_EQ("multi\nline", fields[0]);
+	EXPECT_FALSE(reader.next(fields));
+
+	int value = 0;
+	EXPECT_NO_THROW(parseField("42", value));
+	EXPECT_EQ(42, value);
+	EXPECT_THROW(parseField("42x", value), std::runtime_error);
+}
+
+struct TestPredicate : public Predicate
+{
+	TestPredicate& testEq(int value) { add("test", "=", std::to_string(value)); return *this; }
+	TestPredicate& testIn(const std::vector<int>& values) { addIn("test", values); return *this; }
+	TestPredicate& expression(const std::string& sql, const std::vector<std::string>& args) { addExpression(sql, args); return *this; }
+};
+
+TEST(Predicate, Shapes)
+{
+	EXPECT_EQ("", TestPredicate().where());
+
+	TestPredicate a, b;
+	a.testEq(1).testIn({1, 2, 3});
+	b.testEq(5).testIn({4, 5, 6, 7});
+
+	// Same shape, same statement
+	EXPECT_EQ(" where `test` = ? and `test` in (?,?,?,?)", a.where());
+	EXPECT_EQ(a.where(), b.where());
+	EXPECT_EQ(std::vector<std::string>({"1", "1", "2", "3", "3"}), a.getArgs());
+
+	SQLiteConnection c;
+	c.connect(":memory:");
+	c.query("create table Test (test int)");
+	c.query("insert into Test (test) values (3), (4), (5)");
+
+	DatabaseResult result;
+	c.query("select * from Test" + a.where(), a.getArgs(), result);
+	EXPECT_EQ(0, result.size());
+	c.query("select * from Test" + b.where(), b.getArgs(), result);
+	EXPECT_EQ(1, result.size());
+}
+
+struct Product
+{
+	long long value = 1;
+	void step(long long x) { value *= x; }
+	long long finish() const { return value; }
+};
+
+TEST(SQLite, Functions)
+{
+	SQLiteConnection c;
+	c.connect(":memory:");
+	c.query("create table Test (test int, name text)");
+	c.query("insert into Test (test, name) values (2, ' A '), (3, 'b'), (4, ' C')");
+
+	c.createFunction("normalize", std::function<std::string(const std::string&)>([](const std::string& s) {
+		std::string result;
+		for(char ch : s)
+			if(ch != ' ') result += std::tolower(ch);
+		return result;
+	}));
+	c.createFunction("fail", std::function<int(int)>([](int) -> int { throw std::runtime_error("failed"); }));
+	c.createAggregate<Product>("product");
+
+	std::string value;
+	EXPECT_TRUE(c.queryScalar("select product(test) from Test where normalize(name) <> ?", {"b"}, value));
+	EXPECT_EQ("8", value);
+	EXPECT_TRUE(c.queryScalar("select product(test) from Test where test > 10", {}, value));
+	EXPECT_EQ("1", value);
+	EXPECT_THROW(c.queryScalar("select fail(test) from Test", {}, value), std::runtime_error);
+
+	TestPredicate where;
+	where.testIn({2, 3, 4}).expression("normalize(name) = ?", {"c"});
+	DatabaseResult result;
+	c.query("select * from Test" + where.where(), where.getArgs(), result);
+	ASSERT_EQ(1, result.size());
+	EXPECT_EQ("4", result[0]["test"]);
+}
+
+TEST(ObjectCache, LRU)
+{
+	ObjectCache<std::string> cache(2, 1);
+	cache.put(1, "one");
+	cache.put(2, "two");
+
+	std::string value;
+	EXPECT_TRUE(cache.get(1, value));
+	EXPECT_EQ("one", value);
+
+	// 2 is the least recently used entry now
+	cache.put(3, "three");
+	EXPECT_FALSE(cache.get(2, value));
+	EXPECT_TRUE(cache.get(3, value));
+
+	cache.erase(3);
+	EXPECT_FALSE(cache.get(3, value));
+
+	auto stats = cache.getStats();
+	EXPECT_EQ(2, stats.hits);
+	EXPECT_EQ(2, stats.misses);
+	EXPECT_EQ(1, stats.evictions);
+	EXPECT_EQ(1, stats.entries);
+}
+
+TEST(ResultCache, TableVersions)
+{
+	ResultCache cache(2, std::chrono::hours(1));
+	const std::vector<size_t> tables = {1};
+	const std::string key = ResultCache::makeKey("script", {"a", "b"});
+	EXPECT_NE(key, ResultCache::makeKey("script", {"ab"}));
+
+	std::string value;
+	EXPECT_FALSE(cache.get(key, tables, value));
+	cache.put(key, cache.getVersions(tables), "result");
+	EXPECT_TRUE(cache.get(key, tables, value));
+	EXPECT_EQ("result", value);
+
+	// Other tables do not matter
+	cache.touch(0);
+	EXPECT_TRUE(cache.get(key, tables, value));
+
+	cache.touch(1);
+	EXPECT_FALSE(cache.get(key, tables, value));
+	EXPECT_EQ(0, cache.getStats().entries);
+}
+
+TEST(Generated, Projection)
+{
+	auto connection = std::make_shared<SQLiteConnection>();
+	connection->connect(":memory:");
+	test::test db(connection);
+	db.install();
+
+	test::table object;
+	object.field1 = "first";
+	object.field2 = "second";
+	object.field3 = "third";
+	db.create(object);
+
+	// Only the selected fields are read, the others keep their values
+	test::table partial;
+	ASSERT_TRUE(db.gettableFields(object.id, test::table::field1Field | test::table::field3Field, partial));
+	EXPECT_EQ(object.id, partial.id);
+	EXPECT_EQ("first", partial.field1);
+	EXPECT_EQ("", partial.field2);
+	EXPECT_EQ("third", partial.field3);
+	EXPECT_FALSE(db.gettableFields(object.id + 1, test::table::field1Field, partial));
+
+	std::vector<test::table> out;
+	db.findtableFields(out, test::table::field2Field, test::tablePredicate().field1Eq("first"));
+	ASSERT_EQ(1, out.size());
+	EXPECT_EQ("", out[0].field1);
+	EXPECT_EQ("second", out[0].field2);
+
+	EXPECT_EQ("`id`, `field2`", test::test::tableColumns(test::table::field2Field));
+}
+
+TEST(Generated, GetMany)
+{
+	auto connection = std::make_shared<SQLiteConnection>();
+	connection->connect(":memory:");
+	test::test db(connection);
+	db.install();
+
+	test::table object;
+	object.field1 = "first";
+	db.create(object);
+
+	// Objects left in out by earlier calls do not hide missing ids
+	std::unordered_map<unsigned long long, test::table> out;
+	out[object.id + 1] = object;
+
+	auto missing = db.getManytable({object.id, object.id + 1}, out);
+	ASSERT_EQ(1, missing.size());
+	EXPECT_EQ(object.id + 1, missing[0]);
+	EXPECT_EQ("first", out[object.id].field1);
+}
+
+TEST(Generated, Search)
+{
+	auto connection = std::make_shared<SQLiteConnection>();
+	connection->connect(":memory:");
+	test::test db(connection);
+	db.install();
+
+	test::table object;
+	object.field1 = "first";
+	object.field3 = "third";
+	db.create(object);
+
+	object.field1 = "changed";
+	db.update(object);
+
+	std::vector<test::table> out;
+	db.searchtable(out, "chan");
+	ASSERT_EQ(1, out.size());
+	EXPECT_EQ(object.id, out[0].id);
+
+	out.clear();
+	db.searchtable(out, "first");
+	EXPECT_TRUE(out.empty());
+
+	// Only updates of searchable columns touch the index
+	std::string trigger;
+	ASSERT_TRUE(connection->queryScalar("select sql from sqlite_master where name = 'table_fts_update'", {}, trigger));
+	EXPECT_NE(std::string::npos, trigger.find("after update of `field1`, `field2` on `table`"));
+}
+
+TEST(Generated, BeginCommit)
+{
+	auto connection = std::make_shared<SQLiteConnection>();
+	connection->connect(":memory:");
+	test::test db(connection);
+	db.install();
+	db.enabletableCache(16);
+
+	test::table object;
+	object.field1 = "first";
+	db.create(object);
+
+	// Objects read inside of a transaction are not cached
+	db.begin();
+	EXPECT_EQ(1, connection->getTransactionDepth());
+	test::table read;
+	ASSERT_TRUE(db.get(object.id, read));
+	EXPECT_EQ(0, db.gettableCacheStats().entries);
+
+	// Nested calls become savepoints
+	db.begin();
+	db.rollback();
+	db.commit();
+	EXPECT_EQ(0, connection->getTransactionDepth());
+
+	EXPECT_THROW(db.commit(), std::runtime_error);
+	EXPECT_THROW(db.rollback(), std::runtime_error);
+}
+
+TEST(Generated, Page)
+{
+	auto connection = std::make_shared<SQLiteConnection>();
+	connection->connect(":memory:");
+	test::test db(connection);
+	db.install();
+
+	for(int i = 0; i < 3; i++)
+	{
+		test::table object;
+		object.field1 = std::to_string(i);
+		db.create(object);
+	}
+
+	std::vector<test::table> out;
+	const unsigned long long cursor = db.findtablePage(out, test::tablePredicate(), 2);
+	ASSERT_EQ(2, out.size());
+	EXPECT_EQ(out[1].id, cursor);
+
+	// The limit is bound, so other page sizes use the same statement
+	std::vector<test::table> all;
+	EXPECT_EQ(0, db.findtablePage(all, test::tablePredicate(), 5));
+	EXPECT_EQ(3, all.size());
+
+	size_t statements = 0;
+	for(auto& status : connection->getStatementStatus())
+		statements += status.first.find("limit ?") != std::string::npos;
+	EXPECT_EQ(1, statements);
+
+	out.clear();
+	EXPECT_EQ(0, db.findtablePage(out, test::tablePredicate(), 5, cursor));
+	ASSERT_EQ(1, out.size());
+	EXPECT_EQ("2", out[0].field1);
+
+	EXPECT_THROW(db.findtablePage(out, test::tablePredicate(), 0), std::invalid_argument);
+}
+
+TEST(Generated, Blob)
+{
+	auto connection = std::make_shared<SQLiteConnection>();
+	connection->connect(":memory:");
+	test::test db(connection);
+	db.install();
+
+	test::table2 object;
+	object.data = {std::byte(0x00), std::byte(0xff), std::byte('"'), std::byte('\n')};
+	db.create(object);
+
+	// Lookups bind blobs as blobs, so they match the rows written by create
+	std::vector<test::table2> found;
+	db.findtable2Bydata(found, object.data);
+	ASSERT_EQ(1, found.size());
+	EXPECT_EQ(object.data, found[0].data);
+
+	// Exported as hex and loaded back as blobs
+	FILE* file = fopen("blob.csv", "w");
+	ASSERT_NE(nullptr, file);
+	EXPECT_EQ(1, db.exporttable2(fileno(file)));
+	fclose(file);
+
+	std::ifstream in("blob.csv");
+	const std::string csv((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+	EXPECT_EQ("id,data,field,reference\r\n" + std::to_string(object.id) + ",00ff220a,0,0\r\n", csv);
+
+	db.deletetable2(object.id);
+	EXPECT_EQ(1, db.loadtable2CSV("blob.csv").rows);
+
+	found.clear();
+	db.findtable2Bydata(found, object.data);
+	ASSERT_EQ(1, found.size());
+	EXPECT_EQ(object.id, found[0].id);
+	std::remove("blob.csv");
+}
+
+TEST(Generated, Export)
+{
+	auto connection = std::make_shared<SQLiteConnection>();
+	connection->connect(":memory:");
+	test::test db(connection);
+	db.install();
+
+	test::table quoted;
+	quoted.field1 = "a,b";
+	quoted.field2 = "say \"hi\"\nbye";
+	quoted.field3 = "plain";
+	db.create(quoted);
+
+	for(int i = 0; i < 2; i++)
+	{
+		test::table object;
+		object.field1 = std::to_string(i);
+		db.create(object);
+	}
+
+	auto exportAll = [&](EXPORT_FORMAT format, size_t pageSize, size_t& rows)
+	{
+		FILE* file = tmpfile();
+		rows = db.exporttable(fileno(file), format, pageSize);
+
+		std::string content;
+		char buffer[256];
+		rewind(file);
+		for(size_t read; (read = fread(buffer, 1, sizeof(buffer), file)) > 0;)
+			content.append(buffer, read);
+		fclose(file);
+		return content;
+	};
+
+	// The last page is only partially filled
+	size_t rows = 0;
+	const std::string csv = exportAll(EXPORT_CSV, 2, rows);
+	EXPECT_EQ(3, rows);
+	EXPECT_EQ(0, csv.find("id,field1,field2,field3\r\n1,\"a,b\",\"say \"\"hi\"\"\nbye\",plain\r\n2,0,,\r\n"));
+
+	const std::string json = exportAll(EXPORT_NDJSON, 10, rows);
+	EXPECT_EQ(3, rows);
+	EXPECT_EQ(0, json.find("{\"id\":1,\"field1\":\"a,b\",\"field2\":\"say \\\"hi\\\"\\nbye\",\"field3\":\"plain\"}\n"));
+
+	// Magic, column count and length prefixed column names
+	const std::string binary = exportAll(EXPORT_BINARY, 10, rows);
+	EXPECT_EQ(3, rows);
+	const uint32_t header[] = {4, 2};
+	ASSERT_GT(binary.size(), 12);
+	EXPECT_EQ("LSQL", binary.substr(0, 4));
+	EXPECT_EQ(0, memcmp(binary.data() + 4, header, sizeof(header)));
+	EXPECT_EQ("id", binary.substr(12, 2));
+
+	FILE* file = tmpfile();
+	ASSERT_NE(nullptr, file);
+	EXPECT_THROW(db.exporttable(fileno(file), EXPORT_CSV, 0), std::invalid_argument);
+	fclose(file);
+}
+
 TEST(MariaDB, Connect)
 {
 	MariaDBConnection c;